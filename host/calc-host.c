@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <string.h>
+#include "calc-server.h"
+#include "user-func.h"
+
+// Máy chủ tính toán trên Linux: đọc yêu cầu từ stdin, trả lời ra stdout
+// theo cùng giao thức với UART trên thiết bị, tổng kết tốc độ ra stderr.
+int main(void) {
+    char line[SERVER_LINE_MAX];
+    char response[SERVER_RESPONSE_MAX];
+
+    user_func_init();
+
+    int64_t start = server_now_us();
+    while (fgets(line, sizeof(line), stdin)) {
+        int truncated = 0;
+        if (strchr(line, '\n') == NULL && !feof(stdin)) {
+            // Bỏ phần còn lại của dòng quá dài
+            int c;
+            while ((c = getchar()) != '\n' && c != EOF) {}
+            truncated = 1;
+        }
+        int len = server_handle_line(line, truncated, response, sizeof(response));
+        if (len > 0) fwrite(response, 1, len, stdout);
+    }
+    fflush(stdout);
+    int64_t elapsed = server_now_us() - start;
+
+    server_stats_t stats;
+    server_get_stats(&stats);
+    double seconds = elapsed / 1e6;
+    fprintf(stderr, "%u requests, %u errors, %.3f s total, %.3f s evaluating, %.1f expr/s\n",
+            (unsigned)stats.requests, (unsigned)stats.errors, seconds, stats.busy_us / 1e6,
+            seconds > 0 ? stats.requests / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Thay esp_attr.h trên host: Linux không có bộ nhớ RTC hay IRAM nên các thuộc
+// tính đặt vị trí không làm gì.
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
@@ -0,0 +1,8 @@
+#pragma once
+
+// Thay esp_timer trên host: trả về đồng hồ mô phỏng của lcd-emu, nên thời gian
+// bus mà main/i2c-lcd.c báo cáo là thời gian mô phỏng.
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "calc-ui.h"
+#include "expr-history.h"
+#include "user-func.h"
+#include "i2c-lcd.h"
+#include "lcd-fb.h"
+#include "lcd-plot.h"
+#include "lcd-emu.h"
+#include "worker-host.h"
+
+// Phát lại chuỗi phím ghi sẵn qua toàn bộ đường handle_key -> tính -> render_display
+// -> fb_flush (LCD giả lập), đo tốc độ và kiểm tra kết quả với giá trị chuẩn:
+//   ./build-host/key-replay [-n lần] host/replay/*.keys
+//   cmake --build build-host --target key-replay-check
+//
+// Tệp kịch bản, mỗi dòng một lệnh:
+//   # chú thích
+//   keys <các phím>          phím vật lý 0-9 + - * / . =, nhấn lần lượt
+//   expect display <text>    display_buffer
+//   expect result <text>     result_str
+//   expect error <text>      error_str
+//   expect row1 <text>       dòng 1 trên LCD (bỏ khoảng trắng cuối)
+//   expect row2 <text>       dòng 2 trên LCD
+// Dòng keys/expect dài quá REPLAY_LINE_MAX - 2 byte là lỗi, không bị cắt bớt.
+// Mỗi lần lặp bắt đầu từ máy tính trống (lịch sử rỗng, LCD vừa cấp nguồn); hàm
+// người dùng đã định nghĩa thì giữ lại như trong NVS. Trả mã lỗi khác 0 nếu có
+// giá trị sai hoặc có cấp phát bộ nhớ trong lúc phát lại.
+
+#define REPLAY_MAX_STEPS    64
+#define REPLAY_LINE_MAX     96      // byte của một dòng lệnh, kể cả '\n'; dòng dài hơn bị từ chối
+#define REPLAY_ITERATIONS   100
+
+// Các giá trị so được với chuẩn, theo thứ tự của field_names
+enum { FIELD_KEYS = -1, FIELD_DISPLAY, FIELD_RESULT, FIELD_ERROR, FIELD_ROW1, FIELD_ROW2, FIELD_COUNT };
+
+static const char* const field_names[FIELD_COUNT] = {"display", "result", "error", "row1", "row2"};
+
+typedef struct {
+    int field;              // FIELD_KEYS: text là các phím cần nhấn
+    int line;               // dòng trong tệp, để báo lỗi
+    char text[REPLAY_LINE_MAX];
+} step_t;
+
+typedef struct {
+    char name[32];
+    step_t steps[REPLAY_MAX_STEPS];
+    int count;
+    int keys;               // số phím một lần lặp
+} scenario_t;
+
+static scenario_t scenario; // lớn, không đặt trên ngăn xếp
+static fb_screen_t screen;
+static int total_failures = 0;
+
+// Đếm cấp phát: thay malloc của glibc trong cả chương trình, kể cả lời gọi từ
+// bên trong thư viện C (snprintf, ...). Chỉ đếm khi đang phát lại.
+static int counting = 0;
+static long allocations = 0;
+
+#ifdef __GLIBC__
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    if (counting) allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (counting) allocations++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (counting) allocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        printf("FAIL %s: cannot open\n", path);
+        return -1;
+    }
+    const char* base = strrchr(path, '/');
+    snprintf(scenario.name, sizeof(scenario.name), "%s", base ? base + 1 : path);
+    char* dot = strrchr(scenario.name, '.');
+    if (dot) *dot = '\0';
+    scenario.count = 0;
+    scenario.keys = 0;
+
+    // Cùng kích thước với step_t.text: phần sau "keys "/"expect <trường> " luôn
+    // chép trọn, không bao giờ bị cắt rồi so sánh
+    char line[REPLAY_LINE_MAX];
+    int line_no = 0;
+    int error = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        size_t len = strcspn(line, "\r\n");
+        if (line[len] == '\0' && !feof(f)) {
+            if (line[0] == '#') {
+                // Chú thích dài (tiếng Việt tốn 2-3 byte mỗi chữ): bỏ phần còn lại
+                int c;
+                while ((c = fgetc(f)) != EOF && c != '\n') {}
+                continue;
+            }
+            printf("FAIL %s:%d: line too long (max %d)\n", path, line_no, REPLAY_LINE_MAX - 2);
+            error = 1;
+            break;
+        }
+        line[len] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        if (scenario.count == REPLAY_MAX_STEPS) {
+            printf("FAIL %s:%d: too many steps\n", path, line_no);
+            error = 1;
+            break;
+        }
+        step_t* step = &scenario.steps[scenario.count];
+        step->line = line_no;
+        if (strncmp(line, "keys ", 5) == 0) {
+            step->field = FIELD_KEYS;
+            strcpy(step->text, line + 5);
+            scenario.keys += strlen(step->text);
+        } else if (strncmp(line, "expect ", 7) == 0) {
+            // Chữ chuẩn bắt đầu ngay sau một dấu cách, giữ nguyên khoảng trắng đầu
+            const char* name = line + 7;
+            size_t name_len = strcspn(name, " ");
+            step->field = FIELD_KEYS;
+            for (int i = 0; i < FIELD_COUNT; i++) {
+                if (strlen(field_names[i]) == name_len && strncmp(name, field_names[i], name_len) == 0) {
+                    step->field = i;
+                }
+            }
+            if (step->field == FIELD_KEYS) {
+                printf("FAIL %s:%d: unknown field '%.*s'\n", path, line_no, (int)name_len, name);
+                error = 1;
+                break;
+            }
+            strcpy(step->text, name[name_len] ? name + name_len + 1 : "");
+        } else {
+            printf("FAIL %s:%d: cannot parse '%s'\n", path, line_no, line);
+            error = 1;
+            break;
+        }
+        scenario.count++;
+    }
+    fclose(f);
+    return error ? -1 : 0;
+}
+
+// Máy tính như vừa bật nguồn: trạng thái soạn thảo trống, lịch sử rỗng, LCD khởi tạo lại
+static void reset_calculator(void) {
+    clear_calculator();
+    last_input[0] = '\0';
+    saved_result[0] = '\0';
+    history_index = 0;
+    history_recalled = 0;
+    history_clear();
+
+    lcd_emu_reset();
+    lcd_init();
+    fb_init();
+    render_display(&screen);
+    fb_flush(&screen, NULL);
+}
+
+// Một phím qua đúng các bước của vòng lặp chính và task hiển thị
+static void press(char key, int64_t* ui_ns, int64_t* render_ns) {
+    int64_t start = now_ns();
+    ui_press_key(key);
+    ui_poll();
+    int64_t handled = now_ns();
+    render_display(&screen);
+    if (key_layer == KEY_LAYER_PLOT) {
+        plot_view_t view;
+        plot_get_view(&view);
+        plot_render(&screen, &view);
+    }
+    fb_flush(&screen, NULL);
+    *ui_ns += handled - start;
+    *render_ns += now_ns() - handled;
+}
+
+static void lcd_row(int row, char* out) {
+    char shown[LCD_EMU_ROWS][LCD_EMU_COLS + 1];
+    lcd_emu_screen(shown);
+    for (int col = 0; col < LCD_EMU_COLS; col++) {
+        if ((unsigned char)shown[row][col] < 8) shown[row][col] = '#'; // ký tự CGRAM
+    }
+    int len = LCD_EMU_COLS;
+    while (len > 0 && shown[row][len - 1] == ' ') len--;
+    memcpy(out, shown[row], len);
+    out[len] = '\0';
+}
+
+// So một giá trị với chuẩn, trả 1 nếu sai
+static int check(const step_t* step) {
+    char row[LCD_EMU_COLS + 1];
+    const char* actual = row;
+    switch (step->field) {
+        case FIELD_DISPLAY: actual = display_buffer; break;
+        case FIELD_RESULT:  actual = result_str; break;
+        case FIELD_ERROR:   actual = error_str; break;
+        case FIELD_ROW1:    lcd_row(0, row); break;
+        default:            lcd_row(1, row); break;
+    }
+    if (strcmp(actual, step->text) == 0) return 0;
+    printf("FAIL %s:%d: %s is '%s', expected '%s'\n", scenario.name, step->line,
+           field_names[step->field], actual, step->text);
+    return 1;
+}
+
+static void run(int iterations) {
+    int64_t ui_ns = 0, render_ns = 0;
+    int64_t eval_before = worker_host_eval_ns();
+    long alloc_before = allocations;
+    int failures = 0;
+
+    for (int it = 0; it < iterations; it++) {
+        reset_calculator();
+        counting = 1;
+        for (int i = 0; i < scenario.count; i++) {
+            const step_t* step = &scenario.steps[i];
+            if (step->field == FIELD_KEYS) {
+                for (const char* k = step->text; *k; k++) press(*k, &ui_ns, &render_ns);
+            } else if (it == 0) {
+                counting = 0;
+                failures += check(step);
+                counting = 1;
+            }
+        }
+        counting = 0;
+    }
+
+    long allocs = allocations - alloc_before;
+    double seconds = (ui_ns + render_ns) / 1e9;
+    double keys = (double)scenario.keys * iterations;
+    if (allocs > 0) {
+        printf("FAIL %s: %ld allocations while replaying\n", scenario.name, allocs);
+        failures++;
+    }
+    printf("%-14s %5d %10.0f %10.2f %10.2f %10.2f %7ld  %s\n", scenario.name, scenario.keys,
+           seconds > 0 ? keys / seconds : 0.0,
+           (worker_host_eval_ns() - eval_before) / 1e3 / iterations,
+           ui_ns / 1e3 / iterations, render_ns / 1e3 / iterations,
+           allocs, failures ? "FAIL" : "ok");
+    total_failures += failures;
+}
+
+int main(int argc, char** argv) {
+    int iterations = REPLAY_ITERATIONS;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        iterations = atoi(argv[2]);
+        first = 3;
+    }
+    if (iterations < 1 || first >= argc) {
+        fprintf(stderr, "usage: %s [-n iterations] scenario.keys...\n", argv[0]);
+        return 2;
+    }
+
+    user_func_init();
+    history_init();
+
+    // Thời gian trên máy host, mỗi lần lặp; "ui" gồm cả thời gian tính
+    printf("%-14s %5s %10s %10s %10s %10s %7s\n", "scenario", "keys", "keys/s",
+           "eval us", "ui us", "render us", "allocs");
+    for (int i = first; i < argc; i++) {
+        if (load(argv[i]) != 0) {
+            total_failures++;
+            continue;
+        }
+        run(iterations);
+    }
+    return total_failures ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "i2c-lcd.h"
+#include "lcd-fb.h"
+#include "lcd-plot.h"
+#include "lcd-emu.h"
+
+// Phát lại các kịch bản giao diện qua driver LCD thật (i2c-lcd.c, lcd-fb.c,
+// lcd-plot.c) nối với bộ giả lập PCF8574 + HD44780, đo từng khung và trả về
+// mã lỗi khác 0 nếu vượt ngân sách - dùng làm chốt chặn hồi quy hiển thị:
+//   cmake --build build-host --target lcd-budget
+
+// Ngân sách cho mỗi khung của một kịch bản
+typedef struct {
+    const char* name;
+    int max_bytes;          // byte trên dây, gồm cả byte địa chỉ
+    int max_transactions;   // số cặp START/STOP
+    int max_bus_us;         // thời gian bus theo mô hình
+} budget_t;
+
+// Kết quả gom của một kịch bản
+typedef struct {
+    int frames;
+    int total_bytes;
+    int max_bytes;
+    int max_transactions;
+    int64_t max_bus_us;
+    int failures;
+} result_t;
+
+static int total_failures = 0;
+
+// Soạn màn hình soạn thảo giống render_display: cửa sổ 16 ký tự bám theo con trỏ,
+// dòng 2 là dấu con trỏ
+static void compose_edit(fb_screen_t* screen, const char* expr, int cursor, int* offset, char mark) {
+    int len = strlen(expr);
+    if (len > FB_COLS) {
+        if (cursor < *offset) *offset = cursor;
+        else if (cursor >= *offset + FB_COLS) *offset = cursor - (FB_COLS - 1);
+    } else {
+        *offset = 0;
+    }
+    int left = *offset < FB_MARGIN ? *offset : FB_MARGIN;
+    fb_clear(screen);
+    fb_set_scroll(screen, *offset);
+    fb_put_string(screen, 0, -left, expr + *offset - left);
+    if (cursor - *offset >= 0 && cursor - *offset < FB_COLS) {
+        fb_put_char(screen, 1, cursor - *offset, mark);
+    }
+}
+
+// Gửi một khung, đo bằng bộ đếm của bộ giả lập và so nội dung LCD với màn hình đã soạn
+static void frame(const budget_t* budget, result_t* result, fb_screen_t* screen, const plot_view_t* plot) {
+    lcd_emu_stats_t before, after;
+    lcd_emu_get_stats(&before);
+    if (plot) plot_render(screen, plot);
+    fb_flush(screen, NULL);
+    lcd_emu_get_stats(&after);
+
+    int bytes = after.bytes - before.bytes;
+    int transactions = after.transactions - before.transactions;
+    int64_t bus_us = after.bus_us - before.bus_us;
+    result->frames++;
+    result->total_bytes += bytes;
+    if (bytes > result->max_bytes) result->max_bytes = bytes;
+    if (transactions > result->max_transactions) result->max_transactions = transactions;
+    if (bus_us > result->max_bus_us) result->max_bus_us = bus_us;
+
+    const char* why = NULL;
+    char shown[LCD_EMU_ROWS][LCD_EMU_COLS + 1];
+    lcd_emu_screen(shown);
+    for (int row = 0; row < FB_ROWS && !why; row++) {
+        if (memcmp(shown[row], &screen->cells[row][FB_MARGIN], FB_COLS) != 0) why = "screen mismatch";
+    }
+    if (!why && after.busy_violations != before.busy_violations) why = "sent while busy";
+    if (!why && bytes > budget->max_bytes) why = "bytes over budget";
+    if (!why && transactions > budget->max_transactions) why = "transactions over budget";
+    if (!why && bus_us > budget->max_bus_us) why = "bus time over budget";
+    if (why) {
+        printf("FAIL %s frame %d: %s (%d bytes, %d transactions, %lld us)\n", budget->name,
+               result->frames, why, bytes, transactions, (long long)bus_us);
+        for (int row = 0; row < LCD_EMU_ROWS; row++) {
+            for (int col = 0; col < LCD_EMU_COLS; col++) {
+                if ((unsigned char)shown[row][col] < 8) shown[row][col] = '#'; // ký tự CGRAM
+            }
+        }
+        printf("     LCD: [%s] [%s]\n", shown[0], shown[1]);
+        result->failures++;
+    }
+}
+
+static void report(const budget_t* budget, const result_t* result) {
+    printf("%-12s %6d %8d %9d/%-4d %6d/%-3d %7lld/%-6d %s\n", budget->name, result->frames,
+           result->total_bytes, result->max_bytes, budget->max_bytes,
+           result->max_transactions, budget->max_transactions,
+           (long long)result->max_bus_us, budget->max_bus_us,
+           result->failures ? "FAIL" : "ok");
+    total_failures += result->failures;
+}
+
+// Gõ từng ký tự một biểu thức dài hơn màn hình
+static void scenario_typing(void) {
+    const budget_t budget = {"typing", 32, 1, 800};
+    result_t result = {0};
+    const char* text = "sin(30)+root(16)*2-ln(e)/4+12345";
+    char expr[80] = "";
+    int offset = 0;
+    fb_screen_t screen;
+    compose_edit(&screen, expr, 0, &offset, '_');
+    fb_flush(&screen, NULL);
+    for (int i = 0; text[i]; i++) {
+        expr[i] = text[i];
+        expr[i + 1] = '\0';
+        compose_edit(&screen, expr, i + 1, &offset, '_');
+        frame(&budget, &result, &screen, NULL);
+    }
+    report(&budget, &result);
+}
+
+// Chế độ thứ 3: con trỏ đi hết biểu thức sang trái rồi quay lại
+static void scenario_cursor(void) {
+    const budget_t budget = {"cursor-pan", 28, 1, 650};
+    result_t result = {0};
+    const char* expr = "[0,3.1416,0.01](sin(x)*x^2+root(x+1))";
+    int len = strlen(expr);
+    int offset = 0;
+    fb_screen_t screen;
+    compose_edit(&screen, expr, len, &offset, '^');
+    fb_flush(&screen, NULL);
+    for (int cursor = len - 1; cursor >= 0; cursor--) {
+        compose_edit(&screen, expr, cursor, &offset, '^');
+        frame(&budget, &result, &screen, NULL);
+    }
+    for (int cursor = 1; cursor <= len; cursor++) {
+        compose_edit(&screen, expr, cursor, &offset, '^');
+        frame(&budget, &result, &screen, NULL);
+    }
+    report(&budget, &result);
+}
+
+// Nhấn '=': dòng 2 chuyển từ con trỏ sang kết quả, rồi quay lại soạn thảo
+static void scenario_result(void) {
+    const budget_t budget = {"result", 64, 1, 1500};
+    result_t result = {0};
+    const char* exprs[] = {"12+34*5", "root(2)", "sin(30)+ln(e)", "2^10/3"};
+    const char* results[] = {"182", "1.41421356", "1.5", "341.333333"};
+    int offset = 0;
+    fb_screen_t screen;
+    for (int i = 0; i < 4; i++) {
+        compose_edit(&screen, exprs[i], strlen(exprs[i]), &offset, '_');
+        fb_flush(&screen, NULL);
+        fb_put_string(&screen, 1, 0, "                ");
+        fb_put_string(&screen, 1, 0, results[i]);
+        frame(&budget, &result, &screen, NULL);
+    }
+    report(&budget, &result);
+}
+
+// Đồ thị: mở, dịch trái phải và phóng to thu nhỏ
+static void scenario_plot(void) {
+    const budget_t budget = {"plot", 420, 4, 9500};
+    result_t result = {0};
+    fb_screen_t screen;
+    if (plot_open("x^2-1", -2, 2) != BC_OK) {
+        printf("FAIL plot: cannot compile\n");
+        total_failures++;
+        return;
+    }
+    const int moves[] = {0, 1, 1, -1, 2, -2, 0};
+    for (int i = 0; i < 7; i++) {
+        if (moves[i] == 1 || moves[i] == -1) plot_pan(moves[i]);
+        if (moves[i] == 2) plot_zoom(1);
+        if (moves[i] == -2) plot_zoom(-1);
+        plot_view_t view;
+        plot_get_view(&view);
+        fb_clear(&screen);
+        frame(&budget, &result, &screen, &view);
+    }
+    report(&budget, &result);
+}
+
+// Khởi động: LCD được khởi tạo sau khi ứng dụng đã chạy start_us (task hiển
+// thị bắt đầu ngay, hoặc trễ khi bootloader chậm). Đo từ lúc cấp nguồn tới khi
+// khung đầu tiên lên màn hình; không được gửi lệnh lúc LCD chưa sẵn sàng.
+static void boot_case(const char* name, int64_t start_us, int64_t budget_us) {
+    lcd_emu_reset();
+    usleep(start_us);
+    lcd_init();
+    fb_init();
+    fb_screen_t screen;
+    fb_clear(&screen);
+    fb_put_string(&screen, 0, 0, "Calculator Ready");
+    fb_flush(&screen, NULL);
+
+    lcd_emu_stats_t boot;
+    lcd_emu_get_stats(&boot);
+    char shown[LCD_EMU_ROWS][LCD_EMU_COLS + 1];
+    lcd_emu_screen(shown);
+    int64_t ready_us = lcd_emu_now_us();
+    int ok = ready_us <= budget_us && boot.busy_violations == 0 &&
+             strcmp(shown[0], "Calculator Ready") == 0;
+    printf("boot %-8s %6lld us to first frame (budget %lld), %d bytes, %d busy polls %s\n",
+           name, (long long)ready_us, (long long)budget_us, boot.bytes, boot.reads, ok ? "ok" : "FAIL");
+    if (!ok) total_failures++;
+}
+
+int main(void) {
+    boot_case("cold", 0, 62000);
+    boot_case("late", 60000, 72000);    // nguồn đã ổn định: không còn chờ 50 ms
+
+    printf("%-12s %6s %8s %14s %10s %14s\n", "scenario", "frames", "bytes", "max bytes/bud",
+           "txn/bud", "bus us/bud");
+    scenario_typing();
+    scenario_cursor();
+    scenario_result();
+    scenario_plot();
+
+    if (total_failures) {
+        printf("%d frame(s) over budget\n", total_failures);
+        return 1;
+    }
+    return 0;
+}
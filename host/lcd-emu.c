@@ -0,0 +1,212 @@
+#include "lcd-emu.h"
+#include <string.h>
+#include <unistd.h>
+#include "sdkconfig.h"
+
+// PCF8574 pins: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4-P7 = D4-D7
+#define PIN_RS  0x01
+#define PIN_RW  0x02
+#define PIN_EN  0x04
+#define PIN_DATA 0xF0
+
+// HD44780 execution times at the nominal 270 kHz oscillator
+#define EXEC_US_DEFAULT 37
+#define EXEC_US_DATA    41
+#define EXEC_US_HOME    1520
+// After Vcc rises the controller ignores the bus until its supply is stable;
+// the datasheet asks for more than 40 ms past 2.7 V
+#define POWER_ON_US     40000
+
+// One bit time at the configured bus clock, in nanoseconds
+#define BIT_NS (1000000000LL / CONFIG_CALC_LCD_I2C_FREQ_HZ)
+
+typedef struct {
+    // PCF8574
+    uint8_t latch;              // last byte written to the port
+
+    // HD44780
+    int four_bit;               // DL = 0 after function set
+    int nibble_pending;         // high nibble received, waiting for low
+    uint8_t nibble_high;
+    int read_phase;             // 0 = next read strobe returns high nibble
+    int ac;                     // address counter
+    int cgram_mode;             // AC points into CGRAM
+    int increment;              // I/D
+    int shift;                  // display shift, first visible DDRAM column
+    uint8_t ddram[LCD_EMU_ROWS][LCD_EMU_DDRAM_COLS];
+    uint8_t cgram[64];
+    int64_t busy_until_ns;
+
+    int64_t now_ns;
+    int64_t bus_ns;
+    lcd_emu_stats_t stats;
+} lcd_emu_t;
+
+static lcd_emu_t emu;
+
+void lcd_emu_reset(void) {
+    memset(&emu, 0, sizeof(emu));
+    memset(emu.ddram, ' ', sizeof(emu.ddram));
+    emu.increment = 1;
+    emu.busy_until_ns = POWER_ON_US * 1000LL;
+}
+
+// Account a transaction of len bytes after the address:
+// START, address + data bytes each followed by ACK, STOP
+static void count_transaction(size_t len) {
+    emu.bus_ns += (9 * (int64_t)(len + 1) + 2) * BIT_NS;
+    emu.stats.bytes += len + 1;
+    emu.stats.transactions++;
+}
+
+static void advance_ac(void) {
+    if (emu.cgram_mode) {
+        emu.ac = (emu.ac + (emu.increment ? 1 : -1)) & 0x3F;
+        return;
+    }
+    // Two-line mode: 0x00-0x27 and 0x40-0x67, wrapping from one line to the other
+    int row = emu.ac >= 0x40;
+    int col = (emu.ac & 0x3F) + (emu.increment ? 1 : -1);
+    if (col >= LCD_EMU_DDRAM_COLS) {
+        col = 0;
+        row ^= 1;
+    } else if (col < 0) {
+        col = LCD_EMU_DDRAM_COLS - 1;
+        row ^= 1;
+    }
+    emu.ac = (row ? 0x40 : 0x00) | col;
+}
+
+static void execute(uint8_t value, int rs) {
+    int exec_us = EXEC_US_DEFAULT;
+
+    if (rs) {
+        if (emu.cgram_mode) {
+            emu.cgram[emu.ac] = value & 0x1F;
+        } else {
+            emu.ddram[emu.ac >= 0x40][(emu.ac & 0x3F) % LCD_EMU_DDRAM_COLS] = value;
+        }
+        advance_ac();
+        exec_us = EXEC_US_DATA;
+    } else if (value & 0x80) {
+        emu.ac = value & 0x7F;
+        emu.cgram_mode = 0;
+    } else if (value & 0x40) {
+        emu.ac = value & 0x3F;
+        emu.cgram_mode = 1;
+    } else if (value & 0x20) {
+        emu.four_bit = !(value & 0x10);
+    } else if (value & 0x10) {
+        if (value & 0x08) {
+            // Display shift: R/L = 0 moves the content left
+            emu.shift = (emu.shift + ((value & 0x04) ? LCD_EMU_DDRAM_COLS - 1 : 1)) % LCD_EMU_DDRAM_COLS;
+        } else {
+            advance_ac();
+        }
+    } else if (value & 0x08) {
+        // Display on/off control changes nothing that is modeled
+    } else if (value & 0x04) {
+        emu.increment = (value & 0x02) != 0;
+    } else if (value & 0x02) {
+        emu.ac = 0;
+        emu.cgram_mode = 0;
+        emu.shift = 0;
+        exec_us = EXEC_US_HOME;
+    } else if (value & 0x01) {
+        memset(emu.ddram, ' ', sizeof(emu.ddram));
+        emu.ac = 0;
+        emu.cgram_mode = 0;
+        emu.shift = 0;
+        emu.increment = 1;
+        exec_us = EXEC_US_HOME;
+    }
+    emu.busy_until_ns = emu.now_ns + exec_us * 1000LL;
+}
+
+// Latch on the falling edge of EN, with the bus value that was present while it was high
+static void strobe(uint8_t pins) {
+    if (pins & PIN_RW) {
+        emu.read_phase ^= 1;
+        return;
+    }
+    if (emu.now_ns < emu.busy_until_ns) {
+        // The controller ignores the bus while busy; the nibble is lost
+        emu.stats.busy_violations++;
+        return;
+    }
+    uint8_t nibble = pins & PIN_DATA;
+    int rs = pins & PIN_RS;
+    if (!emu.four_bit) {
+        execute(nibble | 0x0F, rs); // 8-bit interface: unconnected D0-D3 read high (internal pull-ups)
+        return;
+    }
+    if (!emu.nibble_pending) {
+        emu.nibble_high = nibble;
+        emu.nibble_pending = 1;
+    } else {
+        emu.nibble_pending = 0;
+        execute(emu.nibble_high | (nibble >> 4), rs);
+    }
+}
+
+int lcd_emu_write(const uint8_t *data, size_t len) {
+    // Bytes reach the port one after another, so busy checks see each
+    // strobe at its own arrival time
+    emu.now_ns += 10 * BIT_NS; // START + address
+    for (size_t i = 0; i < len; i++) {
+        emu.now_ns += 9 * BIT_NS;
+        if ((emu.latch & PIN_EN) && !(data[i] & PIN_EN)) strobe(emu.latch);
+        emu.latch = data[i];
+    }
+    emu.now_ns += BIT_NS; // STOP
+    count_transaction(len);
+    return 0;
+}
+
+int lcd_emu_read(uint8_t *data) {
+    emu.now_ns += 20 * BIT_NS; // START + address + one byte + STOP
+    count_transaction(1);
+    emu.stats.reads++;
+    uint8_t pins = emu.latch;
+    if ((emu.latch & PIN_EN) && (emu.latch & PIN_RW) && !(emu.latch & PIN_RS)) {
+        // The controller drives D4-D7 with BF | AC, high nibble first;
+        // quasi-bidirectional pins read low wherever either side pulls low
+        uint8_t value = (emu.now_ns < emu.busy_until_ns ? 0x80 : 0x00) | (emu.ac & 0x7F);
+        uint8_t nibble = emu.read_phase ? (uint8_t)(value << 4) : (value & 0xF0);
+        pins = (pins & ~PIN_DATA) | (pins & nibble & PIN_DATA);
+    }
+    *data = pins;
+    return 0;
+}
+
+void lcd_emu_get_stats(lcd_emu_stats_t *stats) {
+    *stats = emu.stats;
+    stats->bus_us = emu.bus_ns / 1000;
+}
+
+int64_t lcd_emu_now_us(void) {
+    return emu.now_ns / 1000;
+}
+
+void lcd_emu_screen(char screen[LCD_EMU_ROWS][LCD_EMU_COLS + 1]) {
+    for (int row = 0; row < LCD_EMU_ROWS; row++) {
+        for (int col = 0; col < LCD_EMU_COLS; col++) {
+            screen[row][col] = emu.ddram[row][(emu.shift + col) % LCD_EMU_DDRAM_COLS];
+        }
+        screen[row][LCD_EMU_COLS] = '\0';
+    }
+}
+
+const uint8_t *lcd_emu_cgram(void) {
+    return emu.cgram;
+}
+
+int64_t esp_timer_get_time(void) {
+    return lcd_emu_now_us();
+}
+
+// The driver's fixed delays advance the modeled clock instead of sleeping
+int usleep(useconds_t us) {
+    emu.now_ns += (int64_t)us * 1000;
+    return 0;
+}
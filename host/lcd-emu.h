@@ -0,0 +1,35 @@
+#pragma once
+
+// Host emulator of the PCF8574 I2C backpack driving an HD44780 controller.
+// Replaces the I2C transport of main/i2c-lcd.c in the host build. Time is
+// modeled, not measured: the clock advances by the bit time of every
+// transfer and by usleep(), so runs are deterministic.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LCD_EMU_ROWS        2
+#define LCD_EMU_COLS        16
+#define LCD_EMU_DDRAM_COLS  40
+
+typedef struct {
+    int bytes;              // bytes on the wire, including address bytes
+    int transactions;       // START ... STOP sequences
+    int reads;              // read transactions (busy flag polls)
+    int busy_violations;    // instructions sent while the controller was still busy
+    int64_t bus_us;         // modeled time the bus was occupied
+} lcd_emu_stats_t;
+
+void lcd_emu_reset(void);  // power-on instant: 8-bit mode, blank DDRAM, clock and counters zeroed, busy for 40 ms
+
+int lcd_emu_write(const uint8_t *data, size_t len);  // one write transaction to the PCF8574, 0 on success
+
+int lcd_emu_read(uint8_t *data);  // one single-byte read transaction, 0 on success
+
+void lcd_emu_get_stats(lcd_emu_stats_t *stats);  // counters since reset
+
+int64_t lcd_emu_now_us(void);  // modeled clock
+
+void lcd_emu_screen(char screen[LCD_EMU_ROWS][LCD_EMU_COLS + 1]);  // visible characters, display shift applied
+
+const uint8_t *lcd_emu_cgram(void);  // 64 bytes of CGRAM, 5 low bits per glyph row
@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include "math-bench.h"
+
+// Đo tốc độ và độ chính xác các hàm toán tự viết (calc-math.c) trên máy host,
+// so với long double libm. In cùng định dạng với lệnh "#math" trên thiết bị để
+// so sánh giữa các phiên bản firmware bằng diff:
+//   ./build-host/math-bench > math-old.txt
+//   cmake --build build-host --target math-report
+// Cột per_call tính bằng ns, dao động theo máy; các cột sai số thì ổn định.
+
+int main(void) {
+    char line[128];
+    int count = math_bench_count();
+    printf("MATH %d " MATH_BENCH_COLUMNS "\n", count);
+    for (int i = 0; i < count; i++) {
+        math_bench_result_t result;
+        math_bench_run(i, &result);
+        math_bench_format(&result, line, sizeof(line));
+        printf("MATH %d %s\n", i, line);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "nvs.h"
+#include <string.h>
+
+#define NVS_HOST_ENTRIES    32
+#define NVS_HOST_NAMESPACES 8
+#define NVS_HOST_VALUE_MAX  1024
+
+typedef struct {
+    nvs_handle_t ns;
+    char key[16];
+    uint8_t value[NVS_HOST_VALUE_MAX];
+    size_t length;
+    int used;
+} nvs_entry_t;
+
+static nvs_entry_t entries[NVS_HOST_ENTRIES];
+static char namespaces[NVS_HOST_NAMESPACES][16];
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    for (int i = 0; i < NVS_HOST_NAMESPACES; i++) {
+        if (namespaces[i][0] == '\0') {
+            strncpy(namespaces[i], name, sizeof(namespaces[i]) - 1);
+        }
+        if (strcmp(namespaces[i], name) == 0) {
+            *handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_FAIL;
+}
+
+static nvs_entry_t *find_entry(nvs_handle_t handle, const char *key) {
+    for (int i = 0; i < NVS_HOST_ENTRIES; i++) {
+        if (entries[i].used && entries[i].ns == handle && strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length) {
+    nvs_entry_t *entry = find_entry(handle, key);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(out, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    if (length > NVS_HOST_VALUE_MAX) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    nvs_entry_t *entry = find_entry(handle, key);
+    for (int i = 0; entry == NULL && i < NVS_HOST_ENTRIES; i++) {
+        if (!entries[i].used) {
+            entry = &entries[i];
+            entry->used = 1;
+            entry->ns = handle;
+            strncpy(entry->key, key, sizeof(entry->key) - 1);
+        }
+    }
+    if (entry == NULL) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *length) {
+    return nvs_get_blob(handle, key, out, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+    return nvs_set_blob(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Cấu hình cho bản build host: phần sdkconfig mà các tệp nguồn biên dịch trên
+// Linux cần tới.
+
+#define CONFIG_CALC_LCD_I2C_FREQ_HZ 400000
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "uart-table.h"
+#include "calc-eval.h"
+
+// Thay main/uart-table.c trên host: cùng lưới, cùng lô và cách định dạng, nhưng
+// các dòng CSV bị bỏ đi thay vì gửi ra UART.
+int table_count(double start, double end, double step) {
+    if (!isfinite(start) || !isfinite(end) || !isfinite(step) || step == 0) return -1;
+    double span = (end - start) / step + 1e-9;
+    if (!(span >= 0)) return -1;
+    return (int)(span < TABLE_MAX_ROWS - 1 ? span : TABLE_MAX_ROWS - 1) + 1;
+}
+
+const char* table_begin(table_job_t* job, const char* expr) {
+    double end;
+    char f_expr[60];
+    job->buf = NULL;
+    job->rows = job->count = 0;
+
+    const char* parse_error = parse_integral_spec(expr, &job->start, &end, &job->step, f_expr, sizeof(f_expr));
+    if (parse_error) return parse_error;
+    if (job->step == 0 || (end - job->start) / job->step < 0) return "Invalid step";
+
+    bc_status_t status = bc_compile(f_expr, &job->prog);
+    if (status != BC_OK) return bc_status_str(status);
+
+    job->count = table_count(job->start, end, job->step);
+    if (job->count < 0) return bc_status_str(BC_ERR_RANGE);
+    return NULL;
+}
+
+int table_step(table_job_t* job) {
+    double xs[TABLE_BLOCK_ROWS], ys[TABLE_BLOCK_ROWS];
+    bc_status_t st[TABLE_BLOCK_ROWS];
+
+    int n = job->count - job->rows;
+    if (n <= 0) return 1;
+    if (n > TABLE_BLOCK_ROWS) n = TABLE_BLOCK_ROWS;
+
+    for (int i = 0; i < n; i++) {
+        xs[i] = job->start + (job->rows + i) * job->step;
+    }
+    bc_run_batch(&job->prog, xs, ys, st, n);
+
+    for (int i = 0; i < n; i++) {
+        char line[48];
+        if (st[i] == BC_OK) {
+            snprintf(line, sizeof(line), "%.7g,%.7g\n", xs[i], ys[i]);
+        } else {
+            snprintf(line, sizeof(line), "%.7g,%s\n", xs[i], bc_status_str(st[i]));
+        }
+    }
+    job->rows += n;
+    return job->rows >= job->count;
+}
+
+int table_percent(const table_job_t* job) {
+    return job->count > 0 ? (int)((int64_t)job->rows * 100 / job->count) : 100;
+}
+
+void table_finish(table_job_t* job) {
+}
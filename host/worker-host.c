@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "calc-worker.h"
+#include "calc-eval.h"
+#include "uart-table.h"
+#include "worker-host.h"
+
+static worker_msg_t pending;
+static int has_pending = 0;
+static int64_t eval_ns = 0;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void worker_start(void) {
+}
+
+int worker_submit(worker_job_t kind, const char* expr) {
+    static integral_job_t job; // lớn, không đặt trên ngăn xếp như worker trên thiết bị
+    static table_job_t table;
+    if (has_pending) return 0;
+
+    int64_t start = now_ns();
+    snprintf(pending.expr, sizeof(pending.expr), "%s", expr);
+    pending.type = WORKER_DONE;
+    pending.job = kind;
+    pending.percent = 100;
+    pending.error[0] = '\0';
+    if (kind == WORKER_JOB_TABLE) {
+        const char* error = table_begin(&table, expr);
+        if (error) {
+            snprintf(pending.result, sizeof(pending.result), "%s", error);
+        } else {
+            while (!table_step(&table)) {}
+            table_finish(&table);
+            snprintf(pending.result, sizeof(pending.result), "Table: %d rows", table.rows);
+        }
+    } else if (expr[0] == '[') {
+        const char* parse_error = integral_begin(&job, expr);
+        if (parse_error) {
+            snprintf(pending.result, sizeof(pending.result), "%s", parse_error);
+        } else {
+            while (!integral_step(&job, 1 << 20)) {}
+            integral_finish(&job, pending.result, sizeof(pending.result),
+                            pending.error, sizeof(pending.error));
+        }
+    } else {
+        evaluate_expression_to(expr, pending.result, sizeof(pending.result));
+    }
+    eval_ns += now_ns() - start;
+    has_pending = 1;
+    return 1;
+}
+
+void worker_cancel(void) {
+    // Công việc đã xong trong worker_submit, không còn gì để hủy
+}
+
+int worker_busy(void) {
+    return has_pending;
+}
+
+int worker_poll(worker_msg_t* msg) {
+    if (!has_pending) return 0;
+    *msg = pending;
+    has_pending = 0;
+    return 1;
+}
+
+int64_t worker_host_eval_ns(void) {
+    return eval_ns;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+// Thay task tính toán nền (main/calc-worker.c) trên host: công việc chạy xong
+// ngay trong worker_submit và kết quả chờ worker_poll lấy, nên phát lại phím
+// cho kết quả xác định và không cần luồng.
+
+int64_t worker_host_eval_ns(void);  // thời gian đã dùng để tính kể từ lúc chạy
@@ -0,0 +1,107 @@
+#include "async-log.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+static const char level_char[] = "?EWID";
+
+#ifdef ESP_PLATFORM
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "console-uart.h"
+
+#define ALOG_DRAIN_MS 20 // drain task poll period
+
+// One record. seq is index + 1 once the text is complete, so the drain task
+// can tell a finished slot from one that is reserved but still being written
+typedef struct {
+    atomic_uint seq;
+    uint8_t level;
+    const char *tag;
+    uint32_t time_ms;
+    char text[ALOG_TEXT_MAX];
+} alog_record_t;
+
+static alog_record_t ring[ALOG_SLOTS];
+static atomic_uint head;      // next index to reserve (any task)
+static atomic_uint tail;      // next index to drain (drain task only)
+static atomic_uint dropped;
+
+void alog_write(int level, const char *tag, const char *fmt, ...) {
+    // Reserve a slot with compare-and-swap so concurrent writers never share one
+    unsigned idx = atomic_load_explicit(&head, memory_order_relaxed);
+    do {
+        if (idx - atomic_load_explicit(&tail, memory_order_acquire) >= ALOG_SLOTS) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&head, &idx, idx + 1,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    alog_record_t *rec = &ring[idx % ALOG_SLOTS];
+    rec->level = level;
+    rec->tag = tag;
+    rec->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(rec->text, sizeof(rec->text), fmt, args);
+    va_end(args);
+    atomic_store_explicit(&rec->seq, idx + 1, memory_order_release);
+}
+
+// Each record goes to the console as one write, so it cannot land inside a
+// server reply or a table row; while a table stream owns the port the drain
+// waits and new records pile up in the ring (and are dropped once it is full)
+static void alog_drain_task(void *arg) {
+    static char line[ALOG_TEXT_MAX + 48];
+    unsigned reported = 0;
+    while (1) {
+        unsigned idx = atomic_load_explicit(&tail, memory_order_relaxed);
+        alog_record_t *rec = &ring[idx % ALOG_SLOTS];
+        if (atomic_load_explicit(&rec->seq, memory_order_acquire) == idx + 1) {
+            int len = snprintf(line, sizeof(line), "%c (%lu) %s: %s\n", level_char[rec->level < 5 ? rec->level : 0],
+                               (unsigned long)rec->time_ms, rec->tag, rec->text);
+            console_write(line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+            atomic_store_explicit(&tail, idx + 1, memory_order_release);
+            continue;
+        }
+
+        unsigned lost = atomic_load_explicit(&dropped, memory_order_relaxed);
+        if (lost != reported) {
+            int len = snprintf(line, sizeof(line), "W LOG: %u records dropped\n", lost - reported);
+            console_write(line, len);
+            reported = lost;
+        }
+        vTaskDelay(pdMS_TO_TICKS(ALOG_DRAIN_MS));
+    }
+}
+
+void alog_start(void) {
+    xTaskCreate(alog_drain_task, "alog", 3072, NULL, tskIDLE_PRIORITY + 1, NULL);
+}
+
+unsigned alog_dropped(void) {
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+#else // host build: no console to wait for, write straight to stderr
+
+void alog_write(int level, const char *tag, const char *fmt, ...) {
+    char text[ALOG_TEXT_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    fprintf(stderr, "%c %s: %s\n", level_char[level < 5 ? level : 0], tag, text);
+}
+
+void alog_start(void) {
+}
+
+unsigned alog_dropped(void) {
+    return 0;
+}
+
+#endif // ESP_PLATFORM
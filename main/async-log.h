@@ -0,0 +1,37 @@
+#pragma once
+
+#include "sdkconfig.h"
+
+// Logging that never waits for the console: the caller formats one record
+// into a lock-free ring and a low-priority task writes it out. When the ring
+// is full the record is dropped and counted.
+
+#define ALOG_ERROR  1
+#define ALOG_WARN   2
+#define ALOG_INFO   3
+#define ALOG_DEBUG  4
+
+#define ALOG_SLOTS      32      // records in the ring, a power of two
+#define ALOG_TEXT_MAX   112     // formatted text per record, longer text is cut
+
+#ifdef CONFIG_CALC_LOG_LEVEL
+#define ALOG_LEVEL CONFIG_CALC_LOG_LEVEL
+#else
+#define ALOG_LEVEL ALOG_INFO
+#endif
+
+// Levels above ALOG_LEVEL compile to nothing, arguments are not evaluated
+#define ALOG_AT(level, tag, fmt, ...) do { \
+        if ((level) <= ALOG_LEVEL) alog_write((level), (tag), fmt, ##__VA_ARGS__); \
+    } while (0)
+
+#define ALOGE(tag, fmt, ...) ALOG_AT(ALOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define ALOGW(tag, fmt, ...) ALOG_AT(ALOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define ALOGI(tag, fmt, ...) ALOG_AT(ALOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define ALOGD(tag, fmt, ...) ALOG_AT(ALOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+void alog_start(void);  // start the drain task; records written before this wait in the ring
+
+void alog_write(int level, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));  // format one record, never blocks
+
+unsigned alog_dropped(void);  // records lost to a full ring since boot
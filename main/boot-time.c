@@ -0,0 +1,24 @@
+#include "boot-time.h"
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "async-log.h"
+
+static const char *TAG = "BOOT";
+
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+    "app_main", "keypad", "nvs", "lcd", "first frame", "ready"
+};
+
+static int64_t stage_us[BOOT_STAGE_COUNT];
+static atomic_int marked;
+
+void boot_mark(boot_stage_t stage) {
+    if (stage_us[stage] != 0) return;
+    stage_us[stage] = esp_timer_get_time();
+    // Các mốc được ghi từ app_main và task hiển thị; task ghi mốc cuối cùng in bảng
+    if (atomic_fetch_add(&marked, 1) + 1 != BOOT_STAGE_COUNT) return;
+
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        ALOGI(TAG, "%-12s %7lld us", stage_names[i], (long long)stage_us[i]);
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Các mốc khởi động, tính bằng µs từ lúc ứng dụng bắt đầu chạy (không gồm
+// bootloader). Màn hình được khởi tạo trên task hiển thị song song với NVS,
+// nên thứ tự LCD/NVS có thể đổi giữa các lần khởi động. Bàn phím nhận phím
+// từ BOOT_KEYPAD; các phím nhấn trước BOOT_READY nằm chờ trong hàng đợi.
+typedef enum {
+    BOOT_APP_START,         // vào app_main
+    BOOT_KEYPAD,            // quét phím đã chạy
+    BOOT_NVS,               // NVS, hàm người dùng và lịch sử đã nạp
+    BOOT_LCD,               // LCD xong chuỗi khởi tạo (hoặc nối lại sau deep sleep)
+    BOOT_FIRST_FRAME,       // khung đầu tiên đã lên màn hình
+    BOOT_READY,             // vòng lặp chính bắt đầu xử lý phím
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+void boot_mark(boot_stage_t stage);  // ghi thời điểm của một mốc; mốc cuối cùng được ghi sẽ in bảng thời gian một lần
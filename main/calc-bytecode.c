@@ -0,0 +1,461 @@
+#include "calc-bytecode.h"
+#include "calc-math.h"
+#include "calc-poly.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Trạng thái bộ biên dịch (phân tích đệ quy xuống)
+typedef struct {
+    const char* ptr;
+    bc_program_t* prog;
+    int depth;          // độ sâu ngăn xếp hiện tại
+    bc_status_t status;
+} bc_parser_t;
+
+static bc_resolver_t user_resolver = NULL;
+
+static void skip_spaces(bc_parser_t* p) {
+    while (*p->ptr == ' ') p->ptr++;
+}
+
+static void emit(bc_parser_t* p, uint8_t op, int stack_delta) {
+    if (p->status != BC_OK) return;
+    if (p->prog->code_len >= BC_MAX_CODE) {
+        p->status = BC_ERR_TOO_LONG;
+        return;
+    }
+    p->prog->code[p->prog->code_len++] = op;
+    p->depth += stack_delta;
+    if (p->depth > BC_STACK_SIZE) {
+        p->status = BC_ERR_TOO_LONG;
+        return;
+    }
+    if (p->depth > p->prog->max_stack) p->prog->max_stack = p->depth;
+}
+
+static void emit_const(bc_parser_t* p, double value) {
+    if (p->status != BC_OK) return;
+    if (p->prog->const_count >= BC_MAX_CONST) {
+        p->status = BC_ERR_TOO_LONG;
+        return;
+    }
+    uint8_t index = p->prog->const_count;
+    p->prog->consts[p->prog->const_count++] = value;
+    emit(p, OP_CONST, 1);
+    emit(p, index, 0);
+}
+
+static void parse_expr(bc_parser_t* p);
+
+// Đọc số: chữ số, dấu chấm và phần mũ dạng 1E-3
+static void parse_number(bc_parser_t* p) {
+    char token[24];
+    int len = 0;
+    while ((*p->ptr >= '0' && *p->ptr <= '9') || *p->ptr == '.') {
+        if (len < (int)sizeof(token) - 1) token[len++] = *p->ptr;
+        p->ptr++;
+    }
+    if (*p->ptr == 'E' || *p->ptr == 'e') {
+        const char* exp = p->ptr + 1;
+        if (*exp == '-') exp++;
+        if (*exp >= '0' && *exp <= '9') {
+            while (p->ptr < exp) {
+                if (len < (int)sizeof(token) - 1) token[len++] = *p->ptr;
+                p->ptr++;
+            }
+            while (*p->ptr >= '0' && *p->ptr <= '9') {
+                if (len < (int)sizeof(token) - 1) token[len++] = *p->ptr;
+                p->ptr++;
+            }
+        }
+    }
+    token[len] = '\0';
+    emit_const(p, atof(token));
+}
+
+// Đọc phần trong ngoặc đơn của một lời gọi hàm, con trỏ đang ở sau '('
+static void parse_call_args(bc_parser_t* p) {
+    parse_expr(p);
+    if (p->status != BC_OK) return;
+    skip_spaces(p);
+    if (*p->ptr != ')') {
+        p->status = BC_ERR_PAREN;
+        return;
+    }
+    p->ptr++;
+}
+
+static void parse_primary(bc_parser_t* p) {
+    static const struct {
+        const char* name;
+        uint8_t op;
+    } funcs[] = {
+        {"sin(", OP_SIN_DEG},
+        {"s_(", OP_SIN_RAD},
+        {"root(", OP_SQRT},
+        {"ln(", OP_LN},
+    };
+
+    skip_spaces(p);
+    char c = *p->ptr;
+
+    if ((c >= '0' && c <= '9') || c == '.') {
+        parse_number(p);
+        return;
+    }
+
+    for (int i = 0; i < (int)(sizeof(funcs) / sizeof(funcs[0])); i++) {
+        size_t len = strlen(funcs[i].name);
+        if (strncmp(p->ptr, funcs[i].name, len) == 0) {
+            p->ptr += len;
+            parse_call_args(p);
+            emit(p, funcs[i].op, 0);
+            return;
+        }
+    }
+
+    if (c != '\0' && strchr(BC_USER_FUNC_NAMES, c) && p->ptr[1] == '(') {
+        p->ptr += 2;
+        parse_call_args(p);
+        emit(p, OP_CALL, 0);
+        emit(p, (uint8_t)c, 0);
+        return;
+    }
+
+    if (c == 'x') {
+        p->ptr++;
+        emit(p, OP_X, 1);
+    } else if (strncmp(p->ptr, "pi", 2) == 0) {
+        p->ptr += 2;
+        emit_const(p, PI);
+    } else if (c == 'e') {
+        p->ptr++;
+        emit_const(p, E);
+    } else if (c == '(') {
+        p->ptr++;
+        parse_call_args(p);
+    } else {
+        p->status = BC_ERR_SYNTAX;
+    }
+}
+
+// Dấu trừ một ngôi gắn chặt hơn '^', giống bộ tách token cũ: -2^2 = 4
+static void parse_unary(bc_parser_t* p) {
+    skip_spaces(p);
+    if (*p->ptr == '-') {
+        p->ptr++;
+        parse_unary(p);
+        emit(p, OP_NEG, 0);
+        return;
+    }
+    parse_primary(p);
+}
+
+// Lũy thừa kết hợp phải sang trái
+static void parse_power(bc_parser_t* p) {
+    parse_unary(p);
+    skip_spaces(p);
+    if (p->status == BC_OK && *p->ptr == '^') {
+        p->ptr++;
+        parse_power(p);
+        emit(p, OP_POW, -1);
+    }
+}
+
+static void parse_term(bc_parser_t* p) {
+    parse_power(p);
+    while (p->status == BC_OK) {
+        skip_spaces(p);
+        char op = *p->ptr;
+        if (op != '*' && op != '/') break;
+        p->ptr++;
+        parse_power(p);
+        emit(p, op == '*' ? OP_MUL : OP_DIV, -1);
+    }
+}
+
+// Biểu thức con là đa thức theo x (tới ')' hoặc hết chuỗi): các hệ số vào bảng
+// hằng số, một lệnh OP_POLY thay cho chuỗi OP_POW/OP_MUL/OP_ADD. Bậc 0 và 1 thì
+// các lệnh thường đã đủ ngắn.
+static int parse_poly(bc_parser_t* p) {
+    poly_t poly;
+    const char* end = poly_parse(p->ptr, &poly);
+    if (end == NULL || poly.degree < 2) return 0;
+    if (p->prog->const_count + poly.degree + 1 > BC_MAX_CONST) return 0;
+
+    uint8_t index = p->prog->const_count;
+    for (int k = 0; k <= poly.degree; k++) p->prog->consts[p->prog->const_count++] = poly.c[k];
+    emit(p, OP_POLY, 1);
+    emit(p, (uint8_t)poly.degree, 0);
+    emit(p, index, 0);
+    p->ptr = end;
+    return 1;
+}
+
+static void parse_expr(bc_parser_t* p) {
+    if (parse_poly(p)) return;
+    parse_term(p);
+    while (p->status == BC_OK) {
+        skip_spaces(p);
+        char op = *p->ptr;
+        if (op != '+' && op != '-') break;
+        p->ptr++;
+        parse_term(p);
+        emit(p, op == '+' ? OP_ADD : OP_SUB, -1);
+    }
+}
+
+bc_status_t bc_compile(const char* src, bc_program_t* prog) {
+    memset(prog, 0, sizeof(*prog));
+    prog->version = BC_FORMAT_VERSION;
+
+    bc_parser_t p = { .ptr = src, .prog = prog, .depth = 0, .status = BC_OK };
+    parse_expr(&p);
+    skip_spaces(&p);
+    if (p.status == BC_OK && *p.ptr == ')') p.status = BC_ERR_PAREN;
+    else if (p.status == BC_OK && *p.ptr != '\0') p.status = BC_ERR_SYNTAX;
+
+    if (p.status != BC_OK) prog->code_len = 0;
+    return p.status;
+}
+
+// bc_exec tin chương trình do bc_compile tạo ra. Blob đọc từ flash thì phải đi
+// hết một lượt: mọi toán hạng nằm trong mảng, ngăn xếp không tràn hay cạn và
+// kết thúc với đúng một giá trị.
+bc_status_t bc_validate(const bc_program_t* prog) {
+    if (prog->version != BC_FORMAT_VERSION || prog->code_len == 0 || prog->code_len > BC_MAX_CODE ||
+        prog->const_count > BC_MAX_CONST || prog->max_stack > BC_STACK_SIZE) {
+        return BC_ERR_SYNTAX;
+    }
+
+    int depth = 0;
+    for (int pc = 0; pc < prog->code_len; pc++) {
+        uint8_t op = prog->code[pc];
+        int pops, pushes = 1;
+        switch (op) {
+            case OP_CONST:
+                if (pc + 1 >= prog->code_len || prog->code[++pc] >= prog->const_count) return BC_ERR_SYNTAX;
+                pops = 0;
+                break;
+            case OP_X:
+                pops = 0;
+                break;
+            case OP_POLY: {
+                if (pc + 2 >= prog->code_len) return BC_ERR_SYNTAX;
+                int degree = prog->code[++pc];
+                int index = prog->code[++pc];
+                if (degree > POLY_MAX_DEGREE || index + degree >= prog->const_count) return BC_ERR_SYNTAX;
+                pops = 0;
+                break;
+            }
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_POW:
+                pops = 2;
+                break;
+            case OP_NEG: case OP_SIN_DEG: case OP_SIN_RAD: case OP_SQRT: case OP_LN:
+                pops = 1;
+                break;
+            case OP_CALL:
+                if (pc + 1 >= prog->code_len) return BC_ERR_SYNTAX;
+                pc++;
+                if (prog->code[pc] == '\0' || strchr(BC_USER_FUNC_NAMES, prog->code[pc]) == NULL) return BC_ERR_SYNTAX;
+                pops = 1;
+                break;
+            default:
+                return BC_ERR_SYNTAX;
+        }
+        if (depth < pops) return BC_ERR_SYNTAX;
+        depth += pushes - pops;
+        if (depth > BC_STACK_SIZE) return BC_ERR_SYNTAX;
+    }
+    return depth == 1 ? BC_OK : BC_ERR_SYNTAX;
+}
+
+static bc_status_t bc_exec(const bc_program_t* prog, double x, double* out, int call_depth) {
+    double stack[BC_STACK_SIZE];
+    int sp = 0;
+
+    if (prog->version != BC_FORMAT_VERSION || prog->code_len == 0) return BC_ERR_SYNTAX;
+
+    for (int pc = 0; pc < prog->code_len; pc++) {
+        switch (prog->code[pc]) {
+            case OP_CONST: stack[sp++] = prog->consts[prog->code[++pc]]; break;
+            case OP_X:     stack[sp++] = x; break;
+            case OP_ADD:   sp--; stack[sp-1] += stack[sp]; break;
+            case OP_SUB:   sp--; stack[sp-1] -= stack[sp]; break;
+            case OP_MUL:   sp--; stack[sp-1] *= stack[sp]; break;
+            case OP_DIV:
+                sp--;
+                if (stack[sp] == 0) return BC_ERR_DIV0;
+                stack[sp-1] /= stack[sp];
+                break;
+            case OP_POW:   sp--; stack[sp-1] = my_pow(stack[sp-1], stack[sp]); break;
+            case OP_NEG:   stack[sp-1] = -stack[sp-1]; break;
+            case OP_SIN_DEG: stack[sp-1] = my_sin_deg(stack[sp-1]); break;
+            case OP_SIN_RAD: stack[sp-1] = my_sin_rad(stack[sp-1]); break;
+            case OP_SQRT:
+                if (stack[sp-1] < 0) return BC_ERR_NEG_SQRT;
+                stack[sp-1] = my_sqrt(stack[sp-1]);
+                break;
+            case OP_LN:
+                if (stack[sp-1] <= 0) return BC_ERR_INV_LOG;
+                stack[sp-1] = my_log(stack[sp-1]);
+                break;
+            case OP_CALL: {
+                char name = (char)prog->code[++pc];
+                const bc_program_t* callee = user_resolver ? user_resolver(name) : NULL;
+                if (callee == NULL) return BC_ERR_NO_FUNC;
+                if (call_depth >= BC_MAX_CALL_DEPTH) return BC_ERR_DEPTH;
+                bc_status_t status = bc_exec(callee, stack[sp-1], &stack[sp-1], call_depth + 1);
+                if (status != BC_OK) return status;
+                break;
+            }
+            case OP_POLY: {
+                int degree = prog->code[++pc];
+                const double* c = &prog->consts[prog->code[++pc]];
+                stack[sp++] = poly_horner(c, degree, x);
+                break;
+            }
+            default:
+                return BC_ERR_SYNTAX;
+        }
+    }
+
+    // NaN (ví dụ 0^-1) được báo như chia cho 0, giống bộ đánh giá chuỗi
+    if (stack[0] != stack[0]) return BC_ERR_DIV0;
+    *out = stack[0];
+    return BC_OK;
+}
+
+bc_status_t bc_run(const bc_program_t* prog, double x, double* out) {
+    return bc_exec(prog, x, out, 0);
+}
+
+// Chạy theo lô: mỗi lệnh được giải mã một lần cho BC_BATCH_SIZE mẫu, nên chi
+// phí thông dịch được chia đều. Lỗi của một mẫu không dừng các mẫu còn lại.
+void bc_run_batch(const bc_program_t* prog, const double* xs, double* ys,
+                  bc_status_t* status, int count) {
+    double stack[BC_STACK_SIZE][BC_BATCH_SIZE];
+
+    for (int base = 0; base < count; base += BC_BATCH_SIZE) {
+        int n = count - base;
+        if (n > BC_BATCH_SIZE) n = BC_BATCH_SIZE;
+        const double* x = xs + base;
+        bc_status_t* st = status + base;
+        int sp = 0;
+
+        for (int i = 0; i < n; i++) st[i] = BC_OK;
+        if (prog->version != BC_FORMAT_VERSION || prog->code_len == 0) {
+            for (int i = 0; i < n; i++) st[i] = BC_ERR_SYNTAX;
+            continue;
+        }
+
+        for (int pc = 0; pc < prog->code_len; pc++) {
+            double* rhs = stack[sp > 0 ? sp-1 : 0];  // đỉnh ngăn xếp trước lệnh
+            double* top = rhs;
+            switch (prog->code[pc]) {
+                case OP_CONST: {
+                    double value = prog->consts[prog->code[++pc]];
+                    for (int i = 0; i < n; i++) stack[sp][i] = value;
+                    sp++;
+                    break;
+                }
+                case OP_X:
+                    for (int i = 0; i < n; i++) stack[sp][i] = x[i];
+                    sp++;
+                    break;
+                case OP_ADD:
+                    sp--; top = stack[sp-1];
+                    for (int i = 0; i < n; i++) top[i] += rhs[i];
+                    break;
+                case OP_SUB:
+                    sp--; top = stack[sp-1];
+                    for (int i = 0; i < n; i++) top[i] -= rhs[i];
+                    break;
+                case OP_MUL:
+                    sp--; top = stack[sp-1];
+                    for (int i = 0; i < n; i++) top[i] *= rhs[i];
+                    break;
+                case OP_DIV:
+                    sp--; top = stack[sp-1];
+                    for (int i = 0; i < n; i++) {
+                        if (rhs[i] == 0) st[i] = BC_ERR_DIV0;
+                        else top[i] /= rhs[i];
+                    }
+                    break;
+                case OP_POW:
+                    sp--; top = stack[sp-1];
+                    for (int i = 0; i < n; i++) top[i] = my_pow(top[i], rhs[i]);
+                    break;
+                case OP_NEG:
+                    for (int i = 0; i < n; i++) top[i] = -top[i];
+                    break;
+                case OP_SIN_DEG:
+                    for (int i = 0; i < n; i++) top[i] = my_sin_deg(top[i]);
+                    break;
+                case OP_SIN_RAD:
+                    for (int i = 0; i < n; i++) top[i] = my_sin_rad(top[i]);
+                    break;
+                case OP_SQRT:
+                    for (int i = 0; i < n; i++) {
+                        if (top[i] < 0) st[i] = BC_ERR_NEG_SQRT;
+                        else top[i] = my_sqrt(top[i]);
+                    }
+                    break;
+                case OP_LN:
+                    for (int i = 0; i < n; i++) {
+                        if (top[i] <= 0) st[i] = BC_ERR_INV_LOG;
+                        else top[i] = my_log(top[i]);
+                    }
+                    break;
+                case OP_CALL: {
+                    char name = (char)prog->code[++pc];
+                    const bc_program_t* callee = user_resolver ? user_resolver(name) : NULL;
+                    for (int i = 0; i < n; i++) {
+                        if (st[i] != BC_OK) continue;
+                        if (callee == NULL) st[i] = BC_ERR_NO_FUNC;
+                        else st[i] = bc_exec(callee, top[i], &top[i], 1);
+                    }
+                    break;
+                }
+                case OP_POLY: {
+                    int degree = prog->code[++pc];
+                    const double* c = &prog->consts[prog->code[++pc]];
+                    for (int i = 0; i < n; i++) stack[sp][i] = poly_horner(c, degree, x[i]);
+                    sp++;
+                    break;
+                }
+                default:
+                    for (int i = 0; i < n; i++) st[i] = BC_ERR_SYNTAX;
+                    pc = prog->code_len;
+                    break;
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            double y = stack[0][i];
+            if (st[i] == BC_OK && y != y) st[i] = BC_ERR_DIV0;
+            ys[base + i] = (st[i] == BC_OK) ? y : 0.0;
+        }
+    }
+}
+
+void bc_set_resolver(bc_resolver_t resolver) {
+    user_resolver = resolver;
+}
+
+const char* bc_status_str(bc_status_t status) {
+    switch (status) {
+        case BC_OK:           return "OK";
+        case BC_ERR_SYNTAX:   return "Error: Syntax";
+        case BC_ERR_PAREN:    return "Error: Missing )";
+        case BC_ERR_TOO_LONG: return "Error: Too long";
+        case BC_ERR_NO_FUNC:  return "Error: No func";
+        case BC_ERR_DEPTH:    return "Error: Recursion";
+        case BC_ERR_DIV0:     return "Error: Div/0";
+        case BC_ERR_NEG_SQRT: return "Error: Neg sqrt";
+        case BC_ERR_INV_LOG:  return "Error: Inv log";
+        case BC_ERR_RANGE:    return "Error: Range";
+        case BC_ERR_OUTPUT:   return "Error: UART";
+    }
+    return "Error";
+}
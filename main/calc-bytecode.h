@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+// Phiên bản định dạng bytecode. Tăng giá trị này mỗi khi đổi bộ lệnh hoặc
+// cấu trúc bc_program_t để các định nghĩa đã lưu được biên dịch lại.
+#define BC_FORMAT_VERSION   2
+
+#define BC_MAX_CODE         64      // số byte lệnh tối đa
+#define BC_MAX_CONST        16      // số hằng số tối đa
+#define BC_STACK_SIZE       16      // độ sâu ngăn xếp khi chạy
+#define BC_MAX_CALL_DEPTH   4       // số lần gọi hàm người dùng lồng nhau
+#define BC_USER_FUNC_NAMES  "fgh"   // tên hợp lệ của hàm người dùng
+#define BC_BATCH_SIZE       8       // số mẫu chạy song song trong bc_run_batch
+
+// Mã trạng thái biên dịch / thực thi
+typedef enum {
+    BC_OK = 0,
+    BC_ERR_SYNTAX,
+    BC_ERR_PAREN,
+    BC_ERR_TOO_LONG,
+    BC_ERR_NO_FUNC,
+    BC_ERR_DEPTH,
+    BC_ERR_DIV0,
+    BC_ERR_NEG_SQRT,
+    BC_ERR_INV_LOG,
+    BC_ERR_RANGE,       // khoảng hoặc bước không hợp lệ (vô cực, NaN)
+    BC_ERR_OUTPUT,      // không xuất được kết quả (UART)
+} bc_status_t;
+
+// Bộ lệnh máy ngăn xếp
+enum {
+    OP_CONST,       // theo sau là chỉ số hằng số
+    OP_X,           // đẩy giá trị biến x
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_NEG,
+    OP_SIN_DEG,     // sin(
+    OP_SIN_RAD,     // s_(
+    OP_SQRT,        // root(
+    OP_LN,          // ln(
+    OP_CALL,        // theo sau là tên hàm người dùng
+    OP_POLY,        // theo sau là bậc và chỉ số hằng số của c[0]; Horner theo x
+};
+
+// Chương trình đã biên dịch - kích thước cố định để lưu thẳng vào NVS
+typedef struct {
+    uint8_t version;                // BC_FORMAT_VERSION lúc biên dịch
+    uint8_t code_len;
+    uint8_t const_count;
+    uint8_t max_stack;
+    uint8_t code[BC_MAX_CODE];
+    double consts[BC_MAX_CONST];
+} bc_program_t;
+
+// Hàm tra cứu chương trình của hàm người dùng theo tên
+typedef const bc_program_t* (*bc_resolver_t)(char name);
+
+bc_status_t bc_compile(const char* src, bc_program_t* prog);  // biên dịch biểu thức theo x
+
+bc_status_t bc_validate(const bc_program_t* prog);  // kiểm tra chương trình nạp từ ngoài (NVS) trước khi chạy, BC_ERR_SYNTAX nếu hỏng
+
+bc_status_t bc_run(const bc_program_t* prog, double x, double* out);  // chạy chương trình với giá trị x
+
+void bc_run_batch(const bc_program_t* prog, const double* xs, double* ys,
+                  bc_status_t* status, int count);  // chạy chương trình cho cả mảng x
+
+void bc_set_resolver(bc_resolver_t resolver);  // đăng ký bảng hàm người dùng cho OP_CALL
+
+const char* bc_status_str(bc_status_t status);  // chuỗi lỗi hiển thị trên LCD
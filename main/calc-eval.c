@@ -0,0 +1,663 @@
+#include "calc-eval.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "calc-math.h"
+#include "calc-poly.h"
+#include "user-func.h"
+#include "trace.h"
+
+// Hàm kiểm tra ký tự số
+static int is_digit(char c) {
+    return (c >= '0' && c <= '9');
+}
+
+// Hàm đánh giá biểu thức con - ĐÃ CẬP NHẬT: Thêm xử lý toán tử '^'
+double evaluate_sub_expression(char* expr) {
+    double tokens[20] = {0};
+    char ops[20] = {0};
+    int token_count = 0;
+    int op_count = 0;
+    
+    char* ptr = expr;
+    char current_token[20];
+    int token_index = 0;
+    
+    while (*ptr) {
+        if (*ptr == ' ') {
+            ptr++;
+            continue;
+        }
+        
+        if (*ptr == '-' && (ptr == expr || 
+                           *(ptr-1) == '(' || 
+                           *(ptr-1) == '+' || 
+                           *(ptr-1) == '-' || 
+                           *(ptr-1) == '*' || 
+                           *(ptr-1) == '/' ||
+                           *(ptr-1) == '^')) {
+            token_index = 0;
+            current_token[token_index++] = *ptr++;
+            
+            while (is_digit(*ptr) || *ptr == '.' || 
+                   (*ptr == 'E' || *ptr == 'e') || 
+                   (*ptr == '-' && (*(ptr-1) == 'E' || *(ptr-1) == 'e'))) {
+                current_token[token_index++] = *ptr++;
+            }
+            current_token[token_index] = '\0';
+            tokens[token_count++] = atof(current_token);
+        }
+        else if (is_digit(*ptr) || *ptr == '.') {
+            token_index = 0;
+            while (is_digit(*ptr) || *ptr == '.' || 
+                   (*ptr == 'E' || *ptr == 'e') || 
+                   (*ptr == '-' && (*(ptr-1) == 'E' || *(ptr-1) == 'e'))) {
+                current_token[token_index++] = *ptr++;
+            }
+            current_token[token_index] = '\0';
+            tokens[token_count++] = atof(current_token);
+        } 
+        else if (*ptr == '+' || *ptr == '-' || *ptr == '*' || *ptr == '/' || *ptr == '^') {
+            ops[op_count++] = *ptr++;
+        }
+        else {
+            ptr++;
+        }
+    }
+    
+    // Xử lý toán tử lũy thừa (phải sang trái)
+    for (int i = op_count - 1; i >= 0; i--) {
+        if (ops[i] == '^') {
+            double left = tokens[i];
+            double right = tokens[i+1];
+            double calc_result = my_pow(left, right);
+            
+            tokens[i] = calc_result;
+            
+            for (int j = i+1; j < token_count-1; j++) {
+                tokens[j] = tokens[j+1];
+            }
+            token_count--;
+            
+            for (int j = i; j < op_count-1; j++) {
+                ops[j] = ops[j+1];
+            }
+            op_count--;
+        }
+    }
+    
+    // Xử lý nhân và chia
+    for (int i = 0; i < op_count; ) {
+        if (ops[i] == '*' || ops[i] == '/') {
+            double left = tokens[i];
+            double right = tokens[i+1];
+            double calc_result;
+            
+            if (ops[i] == '*') {
+                calc_result = left * right;
+            } else {
+                if (right == 0) {
+                    return 0.0 / 0.0; // NaN
+                }
+                calc_result = left / right;
+            }
+            
+            tokens[i] = calc_result;
+            
+            for (int j = i+1; j < token_count-1; j++) {
+                tokens[j] = tokens[j+1];
+            }
+            token_count--;
+            
+            for (int j = i; j < op_count-1; j++) {
+                ops[j] = ops[j+1];
+            }
+            op_count--;
+        } else {
+            i++;
+        }
+    }
+    
+    // Xử lý cộng và trừ
+    double final_result = tokens[0];
+    for (int i = 0; i < op_count; i++) {
+        if (ops[i] == '+') {
+            final_result += tokens[i+1];
+        } else if (ops[i] == '-') {
+            final_result -= tokens[i+1];
+        }
+    }
+
+    return final_result;
+}
+
+// Tìm lời gọi hàm người dùng dạng "f(" trong chuỗi
+char* find_user_func_call(char* str) {
+    for (; *str; str++) {
+        if (str[1] == '(' && strchr(BC_USER_FUNC_NAMES, *str)) return str;
+    }
+    return NULL;
+}
+
+// Hàm định dạng kết quả với tối đa 7 chữ số sau dấu chấm
+void format_result(char* result) {
+    char* dot = strchr(result, '.');
+    if (dot == NULL) return;
+    
+    char* end = result + strlen(result) - 1;
+    
+    while (end > dot && *end == '0') {
+        *end = '\0';
+        end--;
+    }
+    
+    if (*end == '.') {
+        *end = '\0';
+    }
+}
+
+// Hàm đánh giá một phần biểu thức đơn lẻ (phiên bản an toàn)
+void evaluate_single_expression_safe(const char* expr, char* result, size_t size) {
+    char work_buffer[80];
+    strncpy(work_buffer, expr, sizeof(work_buffer));
+    work_buffer[sizeof(work_buffer) - 1] = '\0';
+
+    // Xử lý hằng số
+    char* pi_ptr;
+    while ((pi_ptr = strstr(work_buffer, "pi"))) {
+        char new_buffer[80] = "";
+        int prefix_len = pi_ptr - work_buffer;
+        strncat(new_buffer, work_buffer, prefix_len);
+        char num_str[20];
+        snprintf(num_str, sizeof(num_str), "%.7f", PI);
+        strcat(new_buffer, num_str);
+        strcat(new_buffer, pi_ptr + 2);
+        strcpy(work_buffer, new_buffer);
+    }
+    
+    char* e_ptr;
+    while ((e_ptr = strstr(work_buffer, "e"))) {
+        if ((e_ptr > work_buffer && (e_ptr[-1] >= '0' && e_ptr[-1] <= '9')) || 
+            (e_ptr[1] != '\0' && (e_ptr[1] >= '0' && e_ptr[1] <= '9'))) {
+            break;
+        }
+        char new_buffer[80] = "";
+        int prefix_len = e_ptr - work_buffer;
+        strncat(new_buffer, work_buffer, prefix_len);
+        char num_str[20];
+        snprintf(num_str, sizeof(num_str), "%.7f", E);
+        strcat(new_buffer, num_str);
+        strcat(new_buffer, e_ptr + 1);
+        strcpy(work_buffer, new_buffer);
+    }
+
+    // Xử lý các hàm toán học
+    char* func_ptr;
+    while ((func_ptr = strstr(work_buffer, "sin(")) || 
+           (func_ptr = strstr(work_buffer, "s_(")) || 
+           (func_ptr = strstr(work_buffer, "root(")) || 
+           (func_ptr = strstr(work_buffer, "ln(")) ||
+           (func_ptr = find_user_func_call(work_buffer))) {
+        int func_type;
+        int func_len;
+        
+        if (strncmp(func_ptr, "sin(", 4) == 0) {
+            func_type = 1; // sin(degrees)
+            func_len = 4;
+        } else if (strncmp(func_ptr, "s_(", 3) == 0) {
+            func_type = 4; // sin(radians)
+            func_len = 3;
+        } else if (strncmp(func_ptr, "root(", 5) == 0) {
+            func_type = 2; // sqrt
+            func_len = 5;
+        } else if (strncmp(func_ptr, "ln(", 3) == 0) {
+            func_type = 3; // ln
+            func_len = 3;
+        } else if (func_ptr[1] == '(' && strchr(BC_USER_FUNC_NAMES, func_ptr[0])) {
+            func_type = 5; // hàm người dùng đã biên dịch
+            func_len = 2;
+        } else {
+            break;
+        }
+        
+        int paren_level = 1;
+        char* start_ptr = func_ptr + func_len - 1;
+        char* end_ptr = start_ptr + 1;
+        
+        while (*end_ptr && paren_level > 0) {
+            if (*end_ptr == '(') paren_level++;
+            else if (*end_ptr == ')') paren_level--;
+            end_ptr++;
+        }
+        
+        if (paren_level != 0) {
+            strcpy(work_buffer, "Error: Missing )");
+            break;
+        }
+        
+        int sub_len = (end_ptr - start_ptr - 2);
+        char sub_expr[80];
+        strncpy(sub_expr, start_ptr + 1, sub_len);
+        sub_expr[sub_len] = '\0';
+        
+        char sub_result[40];
+        evaluate_single_expression_safe(sub_expr, sub_result, sizeof(sub_result));
+        
+        if (strstr(sub_result, "Error") != NULL) {
+            strcpy(work_buffer, sub_result);
+            break;
+        }
+        double sub_value = atof(sub_result);
+        double func_value;
+        
+        switch (func_type) {
+            case 1: func_value = my_sin_deg(sub_value); break;
+            case 4: func_value = my_sin_rad(sub_value); break;
+            case 2: 
+                if (sub_value < 0) {
+                    strcpy(work_buffer, "Error: Neg sqrt");
+                    goto end_loop;
+                }
+                func_value = my_sqrt(sub_value); 
+                break;
+            case 3: 
+                if (sub_value <= 0) {
+                    strcpy(work_buffer, "Error: Inv log");
+                    goto end_loop;
+                }
+                func_value = my_log(sub_value); 
+                break;
+            case 5: {
+                // Chạy thẳng bytecode đã lưu, không phân tích lại thân hàm
+                bc_status_t status = user_func_call(func_ptr[0], sub_value, &func_value);
+                if (status != BC_OK) {
+                    strcpy(work_buffer, bc_status_str(status));
+                    goto end_loop;
+                }
+                break;
+            }
+            default: func_value = 0;
+        }
+        
+        char new_buffer[80] = "";
+        int prefix_len = func_ptr - work_buffer;
+        strncat(new_buffer, work_buffer, prefix_len);
+        
+        char num_str[20];
+        snprintf(num_str, sizeof(num_str), "%.7f", func_value);
+        format_result(num_str);
+        strcat(new_buffer, num_str);
+        strcat(new_buffer, end_ptr);
+        
+        strcpy(work_buffer, new_buffer);
+    }
+    end_loop:
+
+    // Xử lý các ngoặc đơn
+    char* open_ptr;
+    while ((open_ptr = strchr(work_buffer, '(')) != NULL) {
+        int paren_level = 1;
+        char* close_ptr = open_ptr + 1;
+        
+        while (*close_ptr && paren_level > 0) {
+            if (*close_ptr == '(') paren_level++;
+            else if (*close_ptr == ')') paren_level--;
+            close_ptr++;
+        }
+        
+        if (paren_level != 0) {
+            strcpy(work_buffer, "Error: Missing )");
+            break;
+        }
+        
+        int sub_len = (close_ptr - open_ptr - 2);
+        char sub_expr[80];
+        strncpy(sub_expr, open_ptr + 1, sub_len);
+        sub_expr[sub_len] = '\0';
+        
+        char sub_result[40];
+        evaluate_single_expression_safe(sub_expr, sub_result, sizeof(sub_result));
+        
+        if (strstr(sub_result, "Error") != NULL) {
+            strcpy(work_buffer, sub_result);
+            break;
+        }
+        double sub_value = atof(sub_result);
+        
+        if (sub_value != sub_value) {
+            strcpy(work_buffer, "Error: Div/0");
+            break;
+        }
+        
+        char new_buffer[80] = "";
+        int prefix_len = open_ptr - work_buffer;
+        strncat(new_buffer, work_buffer, prefix_len);
+        
+        char num_str[20];
+        snprintf(num_str, sizeof(num_str), "%.7f", sub_value);
+        format_result(num_str);
+        strcat(new_buffer, num_str);
+        strcat(new_buffer, close_ptr);
+        
+        strcpy(work_buffer, new_buffer);
+    }
+
+    // Đánh giá biểu thức cuối cùng
+    double final_value = evaluate_sub_expression(work_buffer);
+    
+    if (final_value != final_value) {
+        strcpy(work_buffer, "Error: Div/0");
+    } else if (strstr(work_buffer, "Error") == NULL) {
+        snprintf(work_buffer, sizeof(work_buffer), "%.7f", final_value);
+        format_result(work_buffer);
+    }
+    
+    strncpy(result, work_buffer, size);
+    result[size-1] = '\0';
+}
+
+// Các biểu thức cách nhau bởi ':', dừng ở lỗi đầu tiên
+static void evaluate_parts(const char* expr, char* final_result, size_t size) {
+    final_result[0] = '\0';
+    
+    char work_expr[80];
+    strncpy(work_expr, expr, sizeof(work_expr));
+    work_expr[sizeof(work_expr) - 1] = '\0';
+    
+    char* save_ptr;
+    char* part = strtok_r(work_expr, ":", &save_ptr);
+    while (part != NULL) {
+        char part_result[40];
+        evaluate_single_expression_safe(part, part_result, sizeof(part_result));
+        
+        if (strstr(part_result, "Error") != NULL) {
+            snprintf(final_result, size, "%s", part_result);
+            return;
+        }
+        
+        size_t len = strlen(final_result);
+        snprintf(final_result + len, size - len, "%s%s", len ? ":" : "", part_result);
+        
+        part = strtok_r(NULL, ":", &save_ptr);
+    }
+}
+
+// Hàm đánh giá biểu thức vào bộ đệm của người gọi (an toàn khi gọi từ nhiều tác vụ)
+void evaluate_expression_to(const char* expr, char* final_result, size_t size) {
+    TRACE_BEGIN(start);
+    evaluate_parts(expr, final_result, size);
+    TRACE_END(TRACE_EVALUATE, start);
+}
+
+// Hàm đánh giá biểu thức
+char* evaluate_expression(const char* expr) {
+    static char final_result[80] = "";
+    evaluate_expression_to(expr, final_result, sizeof(final_result));
+    return final_result;
+}
+
+// Hàm thay thế 'x' bằng giá trị số
+void replace_x(const char* src, double value, char* dest) {
+    char val_str[20];
+    snprintf(val_str, sizeof(val_str), "%.7f", value);
+    format_result(val_str);
+    
+    int j = 0;
+    for (int i = 0; src[i] != '\0' && j < 79; i++) {
+        if (src[i] == 'x') {
+            strcpy(&dest[j], val_str);
+            j += strlen(val_str);
+        } else {
+            dest[j++] = src[i];
+        }
+    }
+    dest[j] = '\0';
+}
+
+// Hàm tính tích phân bằng phương pháp hình thang
+double trapezoidal_integration(char* expr, double a, double b, double h) {
+    int n = (int)((b - a) / h);
+    if (n <= 0) n = 1;
+    
+    double sum = 0.0;
+    char work_expr[80];
+    char result_buf[40];
+
+    // Điểm đầu
+    replace_x(expr, a, work_expr);
+    evaluate_single_expression_safe(work_expr, result_buf, sizeof(result_buf));
+    double fa = atof(result_buf);
+    
+    // Điểm cuối
+    replace_x(expr, b, work_expr);
+    evaluate_single_expression_safe(work_expr, result_buf, sizeof(result_buf));
+    double fb = atof(result_buf);
+    
+    sum = fa + fb;
+
+    // Các điểm ở giữa
+    for (int i = 1; i < n; i++) {
+        double x = a + i * h;
+        replace_x(expr, x, work_expr);
+        evaluate_single_expression_safe(work_expr, result_buf, sizeof(result_buf));
+        double fx = atof(result_buf);
+        sum += 2.0 * fx;
+    }
+
+    return sum * h / 2.0;
+}
+
+// Tách biểu thức "[a,b](f)" thành a, b và f - trả về NULL nếu hợp lệ, ngược lại là thông báo lỗi.
+// Nếu step khác NULL thì khoảng phải có dạng "[a,b,step]".
+const char* parse_integral_spec(const char* expr, double* a, double* b, double* step, char* f_expr, size_t f_size) {
+    // Tìm vị trí dấu ngoặc vuông
+    const char* open_bracket = strchr(expr, '[');
+    const char* close_bracket = strchr(expr, ']');
+    if (!open_bracket || !close_bracket) {
+        return "Invalid [a,b]";
+    }
+
+    // Trích xuất phần trong [a,b]
+    char range[40];
+    strncpy(range, open_bracket + 1, close_bracket - open_bracket - 1);
+    range[close_bracket - open_bracket - 1] = '\0';
+
+    // Tìm dấu phẩy phân tách a và b
+    char* comma = strchr(range, ',');
+    if (!comma) {
+        return "Missing comma";
+    }
+
+    // Tách a và b
+    char a_str[20], b_str[20];
+    strncpy(a_str, range, comma - range);
+    a_str[comma - range] = '\0';
+    strcpy(b_str, comma + 1);
+
+    // Tách bước nhảy cho chế độ bảng
+    if (step != NULL) {
+        char* step_comma = strchr(b_str, ',');
+        if (!step_comma) {
+            return "Missing step";
+        }
+        *step_comma = '\0';
+
+        char step_eval[40];
+        evaluate_single_expression_safe(step_comma + 1, step_eval, sizeof(step_eval));
+        if (strstr(step_eval, "Error")) {
+            return "Invalid step";
+        }
+        *step = atof(step_eval);
+    }
+
+    // Đánh giá a và b
+    char a_eval[40], b_eval[40];
+    evaluate_single_expression_safe(a_str, a_eval, sizeof(a_eval));
+    evaluate_single_expression_safe(b_str, b_eval, sizeof(b_eval));
+
+    if (strstr(a_eval, "Error") || strstr(b_eval, "Error")) {
+        return "Invalid a/b expr";
+    }
+
+    *a = atof(a_eval);
+    *b = atof(b_eval);
+
+    // Tìm vị trí dấu ngoặc đơn mở sau ']'
+    const char* open_paren = strchr(close_bracket, '(');
+    if (open_paren == NULL) {
+        return "Missing (";
+    }
+    
+    // Tìm vị trí dấu ngoặc đơn đóng tương ứng
+    int paren_level = 1;
+    const char* close_paren = open_paren + 1;
+    while (*close_paren && paren_level > 0) {
+        if (*close_paren == '(') paren_level++;
+        else if (*close_paren == ')') paren_level--;
+        close_paren++;
+    }
+    
+    if (paren_level != 0) {
+        return "Missing )";
+    }
+    
+    // Trích xuất biểu thức hàm
+    int func_len = (close_paren - open_paren - 1);
+    if (func_len <= 0 || func_len > (int)f_size - 1) {
+        return "Invalid func";
+    }
+    
+    strncpy(f_expr, open_paren + 1, func_len);
+    f_expr[func_len] = '\0';
+    
+    // Tìm và loại bỏ dấu ngoặc đóng cuối cùng nếu có
+    char* last_paren = strrchr(f_expr, ')');
+    if (last_paren) {
+        *last_paren = '\0';
+    }
+    return NULL;
+}
+
+#define INTEGRAL_STEP 0.001
+
+// Giá trị f tại x: chạy chương trình đã biên dịch, nếu không được thì như một
+// điểm của trapezoidal_integration (lỗi tính cho giá trị 0 ở cả hai đường)
+static double integral_point(const integral_job_t* job, double x) {
+    if (job->compiled) {
+        double y;
+        return bc_run(&job->prog, x, &y) == BC_OK ? y : 0.0;
+    }
+    char work_expr[80];
+    char result_buf[40];
+    replace_x(job->f_expr, x, work_expr);
+    evaluate_single_expression_safe(work_expr, result_buf, sizeof(result_buf));
+    return atof(result_buf);
+}
+
+// Bắt đầu một lượt: hai điểm đầu cuối, cùng thứ tự cộng như trapezoidal_integration
+static void integral_pass_begin(integral_job_t* job, double h) {
+    job->h = h;
+    job->n = (int)((job->b - job->a) / h);
+    if (job->n <= 0) job->n = 1;
+    job->i = 1;
+    double fa = integral_point(job, job->a);
+    job->fb = integral_point(job, job->b);
+    job->sum = fa + job->fb;
+}
+
+const char* integral_begin(integral_job_t* job, const char* expr) {
+    const char* parse_error = parse_integral_spec(expr, &job->a, &job->b, NULL, job->f_expr, sizeof(job->f_expr));
+    if (parse_error) return parse_error;
+
+    job->pass = 0;
+    job->done = 0;
+    job->result_h = 0.0;
+
+    // Hàm đa thức: tích phân đúng từ các hệ số, không cần lấy mẫu. Công việc
+    // xong ngay (pass = 2), hai kết quả bằng nhau nên sai số ước lượng là 0.
+    poly_t poly;
+    if (poly_from_expr(job->f_expr, &poly)) {
+        double result = poly_integrate(&poly, job->a, job->b);
+        job->h = job->b - job->a;
+        job->n = job->i = 0;
+        job->total = 0;
+        job->fb = 0.0;
+        job->result_h = result;
+        job->sum = result;
+        job->pass = 2;
+        return NULL;
+    }
+
+    // Biên dịch f một lần: đa thức con chạy bằng Horner (OP_POLY), không phải
+    // tách chuỗi và gọi my_pow ở mỗi điểm
+    job->compiled = bc_compile(job->f_expr, &job->prog) == BC_OK;
+
+    integral_pass_begin(job, INTEGRAL_STEP);
+    job->total = (job->n + 1) * 3; // lượt 2 có gấp đôi số điểm
+    return NULL;
+}
+
+int integral_step(integral_job_t* job, int max_points) {
+    TRACE_BEGIN(start);
+    while (job->pass < 2 && max_points-- > 0) {
+        if (job->i < job->n) {
+            double x = job->a + job->i * job->h;
+            job->sum += 2.0 * integral_point(job, x);
+            job->i++;
+            job->done++;
+            continue;
+        }
+        // Hết lượt
+        double result = job->sum * job->h / 2.0;
+        if (job->pass == 0) {
+            job->result_h = result;
+            job->pass = 1;
+            integral_pass_begin(job, job->h / 2);
+        } else {
+            job->sum = result; // kết quả bước h/2
+            job->pass = 2;
+        }
+    }
+    TRACE_END(TRACE_INTEGRAL, start);
+    return job->pass == 2;
+}
+
+int integral_percent(const integral_job_t* job) {
+    if (job->pass == 2) return 100;
+    int percent = job->total > 0 ? (int)(100LL * job->done / job->total) : 0;
+    return percent > 99 ? 99 : percent;
+}
+
+double integral_estimate(const integral_job_t* job) {
+    if (job->pass > 0) return job->result_h;
+    return (job->sum - job->fb) * job->h / 2.0;
+}
+
+void integral_finish(const integral_job_t* job, char* result_str, size_t result_size, char* error_str, size_t error_size) {
+    double result = job->result_h;
+    double result_half = job->sum;
+    double error = my_fabs(result - result_half);
+    
+    // Định dạng kết quả
+    snprintf(result_str, result_size, "%.7f", result);
+    format_result(result_str);
+    result_str[result_size-1] = '\0';
+    
+    // Định dạng sai số
+    snprintf(error_str, error_size, "R:%.4e", error);
+    error_str[error_size-1] = '\0';
+}
+
+// Hàm tính tích phân "[a,b](f)" - ghi kết quả và sai số ước lượng "R:..." vào hai bộ đệm
+void evaluate_integral(const char* expr, char* result_str, size_t result_size, char* error_str, size_t error_size) {
+    integral_job_t job;
+    const char* parse_error = integral_begin(&job, expr);
+    if (parse_error) {
+        snprintf(result_str, result_size, "%s", parse_error);
+        error_str[0] = '\0';
+        return;
+    }
+    while (!integral_step(&job, 1 << 30)) {
+    }
+    integral_finish(&job, result_str, result_size, error_str, error_size);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include "calc-bytecode.h"
+
+void format_result(char* result);  // bỏ các số 0 thừa sau dấu chấm
+
+void evaluate_single_expression_safe(const char* expr, char* result, size_t size);  // một biểu thức, không có ':'
+
+void evaluate_expression_to(const char* expr, char* final_result, size_t size);  // các biểu thức cách nhau bởi ':'
+
+char* evaluate_expression(const char* expr);  // như trên nhưng trả về bộ đệm tĩnh
+
+void replace_x(const char* src, double value, char* dest);  // thay 'x' bằng giá trị số
+
+double trapezoidal_integration(char* expr, double a, double b, double h);  // tích phân hình thang
+
+// Tách "[a,b](f)" (hoặc "[a,b,step](f)" khi step khác NULL); trả về NULL nếu hợp lệ
+const char* parse_integral_spec(const char* expr, double* a, double* b, double* step, char* f_expr, size_t f_size);
+
+// Tích phân tính dần: hai lượt hình thang với bước h và h/2, mỗi lần gọi
+// integral_step chỉ tính vài điểm để người gọi chia việc theo thời gian
+typedef struct {
+    char f_expr[60];
+    bc_program_t prog;      // f đã biên dịch (đa thức con thành OP_POLY)
+    int compiled;           // 0: f không biên dịch được, mỗi điểm đi qua chuỗi
+    double a, b;
+    double h;               // bước của lượt đang chạy
+    int pass;               // 0: bước h, 1: bước h/2, 2: xong
+    int n, i;               // số khoảng của lượt và điểm kế tiếp
+    int total, done;        // số điểm của cả hai lượt, đã tính
+    double fb;
+    double sum;
+    double result_h;        // kết quả lượt bước h
+} integral_job_t;
+
+const char* integral_begin(integral_job_t* job, const char* expr);  // tách "[a,b](f)", trả về lỗi hoặc NULL
+
+int integral_step(integral_job_t* job, int max_points);  // tính tối đa max_points điểm, trả về 1 khi xong
+
+int integral_percent(const integral_job_t* job);  // tiến độ 0-100
+
+double integral_estimate(const integral_job_t* job);  // giá trị tạm: tích phân từ a tới điểm hiện tại, sau lượt 1 là kết quả bước h
+
+void integral_finish(const integral_job_t* job, char* result_str, size_t result_size, char* error_str, size_t error_size);  // định dạng kết quả và "R:..."
+
+// Tính tích phân "[a,b](f)": kết quả vào result_str, sai số ước lượng "R:..." vào error_str
+void evaluate_integral(const char* expr, char* result_str, size_t result_size, char* error_str, size_t error_size);
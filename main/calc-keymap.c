@@ -0,0 +1,130 @@
+#include "calc-keymap.h"
+#include <stddef.h>
+
+// Mã phím theo thứ tự trong KEYMAP_KEYS, dùng làm chỉ số trong các bảng
+enum {
+    K0, K1, K2, K3, K4, K5, K6, K7, K8, K9,
+    K_ADD, K_SUB, K_MUL, K_DIV, K_DOT, K_EQ, K_LPAREN, K_RPAREN,
+};
+
+// Tra mã phím trong một bước: mã + 1, 0 nếu không phải phím trong bảng
+static const int8_t key_codes[128] = {
+    ['0'] = K0 + 1, ['1'] = K1 + 1, ['2'] = K2 + 1, ['3'] = K3 + 1, ['4'] = K4 + 1,
+    ['5'] = K5 + 1, ['6'] = K6 + 1, ['7'] = K7 + 1, ['8'] = K8 + 1, ['9'] = K9 + 1,
+    ['+'] = K_ADD + 1, ['-'] = K_SUB + 1, ['*'] = K_MUL + 1, ['/'] = K_DIV + 1,
+    ['.'] = K_DOT + 1, ['='] = K_EQ + 1, ['('] = K_LPAREN + 1, [')'] = K_RPAREN + 1,
+};
+
+#define DO(a)               { .action = (a), .next = KEY_LAYER_KEEP }
+#define DO_ARG(a, n)        { .action = (a), .next = KEY_LAYER_KEEP, .arg = (n) }
+#define INSERT(s, layer)    { .action = KEY_INSERT, .next = (layer), .text = (s) }
+#define TO(a, layer)        { .action = (a), .next = (layer), .flags = KEY_FORGET }
+
+// Lớp chính: số, phép toán và '='. Nhấn hai lần "**" vào bàn phím thứ 3,
+// ".." vào bàn phím phụ, "//" xóa tất cả.
+static const keymap_layer_t base_layer = {
+    .keys = {
+        [K0] = DO(KEY_OPERAND), [K1] = DO(KEY_OPERAND), [K2] = DO(KEY_OPERAND),
+        [K3] = DO(KEY_OPERAND), [K4] = DO(KEY_OPERAND), [K5] = DO(KEY_OPERAND),
+        [K6] = DO(KEY_OPERAND), [K7] = DO(KEY_OPERAND), [K8] = DO(KEY_OPERAND),
+        [K9] = DO(KEY_OPERAND), [K_LPAREN] = DO(KEY_OPERAND), [K_RPAREN] = DO(KEY_OPERAND),
+        [K_ADD] = DO(KEY_OPERATOR), [K_SUB] = DO(KEY_OPERATOR),
+        [K_MUL] = DO(KEY_OPERATOR), [K_DIV] = DO(KEY_OPERATOR),
+        [K_DOT] = DO(KEY_DECIMAL),
+        [K_EQ] = DO(KEY_EVALUATE),
+    },
+    .chords = {
+        [K_MUL] = TO(KEY_SWITCH, KEY_LAYER_TERTIARY),
+        [K_DOT] = TO(KEY_SWITCH, KEY_LAYER_SECONDARY),
+        [K_DIV] = TO(KEY_CLEAR, KEY_LAYER_BASE),
+    },
+};
+
+// Bàn phím phụ: mỗi phím số chèn một hàm hoặc ký tự, phím khác chỉ thoát
+#define SECONDARY_EXIT  { .action = KEY_NOTHING, .next = KEY_LAYER_BASE }
+static const keymap_layer_t secondary_layer = {
+    .keys = {
+        [K0] = INSERT("^", KEY_LAYER_BASE),     // lũy thừa
+        [K1] = INSERT("sin(", KEY_LAYER_BASE),  // sin theo độ
+        [K2] = INSERT("root(", KEY_LAYER_BASE),
+        [K3] = INSERT("ln(", KEY_LAYER_BASE),
+        [K4] = INSERT("(", KEY_LAYER_BASE),
+        [K5] = INSERT(")", KEY_LAYER_BASE),
+        [K6] = INSERT("pi", KEY_LAYER_BASE),
+        [K7] = INSERT("e", KEY_LAYER_BASE),
+        [K8] = INSERT(":", KEY_LAYER_BASE),     // ngăn cách nhiều biểu thức
+        [K9] = INSERT("s_(", KEY_LAYER_BASE),   // sin theo radian
+        [K_ADD] = SECONDARY_EXIT, [K_SUB] = SECONDARY_EXIT, [K_MUL] = SECONDARY_EXIT,
+        [K_DIV] = SECONDARY_EXIT, [K_DOT] = SECONDARY_EXIT, [K_EQ] = SECONDARY_EXIT,
+        [K_LPAREN] = SECONDARY_EXIT, [K_RPAREN] = SECONDARY_EXIT,
+    },
+};
+
+// Bàn phím thứ 3: sửa biểu thức và các chức năng nâng cao. ".." sang bàn phím
+// phụ, "**" về lớp chính.
+static const keymap_layer_t tertiary_layer = {
+    .keys = {
+        [K0] = INSERT("x):", KEY_LAYER_KEEP),   // hoàn tất "f(" -> "f(x):"
+        [K1] = DO(KEY_HISTORY),
+        [K2] = DO(KEY_INTEGRAL),
+        [K3] = INSERT("x", KEY_LAYER_KEEP),     // biến của tích phân và hàm
+        [K4] = DO_ARG(KEY_CURSOR, -1),
+        [K5] = DO(KEY_DELETE),
+        [K6] = DO_ARG(KEY_CURSOR, 1),
+        [K7] = DO(KEY_SAVED_RESULT),
+        [K8] = DO(KEY_ERROR_ESTIMATE),
+        [K9] = DO(KEY_USER_FUNC),
+        [K_ADD] = DO(KEY_PLOT),
+        [K_SUB] = DO(KEY_TABLE),
+        [K_MUL] = DO(KEY_NOTHING), [K_DIV] = DO(KEY_NOTHING), [K_DOT] = DO(KEY_NOTHING),
+        [K_EQ] = DO(KEY_NOTHING), [K_LPAREN] = DO(KEY_NOTHING), [K_RPAREN] = DO(KEY_NOTHING),
+    },
+    .chords = {
+        [K_MUL] = TO(KEY_NOTHING, KEY_LAYER_BASE),
+        [K_DOT] = TO(KEY_NOTHING, KEY_LAYER_SECONDARY),
+    },
+};
+
+// Đồ thị: 4/6 dịch cửa sổ, 8/2 phóng to/thu nhỏ, phím khác để thoát
+#define PLOT_EXIT   TO(KEY_NOTHING, KEY_LAYER_BASE)
+static const keymap_layer_t plot_layer = {
+    .keys = {
+        [K4] = { .action = KEY_PLOT_PAN, .next = KEY_LAYER_KEEP, .flags = KEY_FORGET, .arg = -1 },
+        [K6] = { .action = KEY_PLOT_PAN, .next = KEY_LAYER_KEEP, .flags = KEY_FORGET, .arg = 1 },
+        [K8] = { .action = KEY_PLOT_ZOOM, .next = KEY_LAYER_KEEP, .flags = KEY_FORGET, .arg = 1 },
+        [K2] = { .action = KEY_PLOT_ZOOM, .next = KEY_LAYER_KEEP, .flags = KEY_FORGET, .arg = -1 },
+        [K0] = PLOT_EXIT, [K1] = PLOT_EXIT, [K3] = PLOT_EXIT, [K5] = PLOT_EXIT,
+        [K7] = PLOT_EXIT, [K9] = PLOT_EXIT,
+        [K_ADD] = PLOT_EXIT, [K_SUB] = PLOT_EXIT, [K_MUL] = PLOT_EXIT, [K_DIV] = PLOT_EXIT,
+        [K_DOT] = PLOT_EXIT, [K_EQ] = PLOT_EXIT, [K_LPAREN] = PLOT_EXIT, [K_RPAREN] = PLOT_EXIT,
+    },
+};
+
+static const keymap_layer_t* const default_layers[KEY_LAYER_COUNT] = {
+    [KEY_LAYER_BASE] = &base_layer,
+    [KEY_LAYER_SECONDARY] = &secondary_layer,
+    [KEY_LAYER_TERTIARY] = &tertiary_layer,
+    [KEY_LAYER_PLOT] = &plot_layer,
+};
+
+// Bảng đang dùng của mỗi lớp, thay được lúc chạy
+static const keymap_layer_t* layers[KEY_LAYER_COUNT] = {
+    [KEY_LAYER_BASE] = &base_layer,
+    [KEY_LAYER_SECONDARY] = &secondary_layer,
+    [KEY_LAYER_TERTIARY] = &tertiary_layer,
+    [KEY_LAYER_PLOT] = &plot_layer,
+};
+
+int keymap_code(char key) {
+    unsigned char c = (unsigned char)key;
+    return c < sizeof(key_codes) ? key_codes[c] - 1 : -1;
+}
+
+const keymap_layer_t* keymap_get(key_layer_t layer) {
+    return layers[layer];
+}
+
+void keymap_set(key_layer_t layer, const keymap_layer_t* map) {
+    if (layer >= KEY_LAYER_COUNT) return;
+    layers[layer] = map ? map : default_layers[layer];
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// Bản đồ phím dạng bảng: mỗi lớp (chế độ nhập) gán cho mỗi phím một hành động
+// và lớp tiếp theo, thêm một bảng tổ hợp cho cùng phím nhấn hai lần liên tiếp.
+// handle_key chỉ tra bảng rồi gọi hành động, nên thêm chế độ mới là thêm dữ
+// liệu, không thêm nhánh. Các bảng mặc định là hằng số nằm trong flash.
+
+#define KEYMAP_KEYS         "0123456789+-*/.=()"    // các phím có trong bảng, theo mã 0..17
+#define KEYMAP_KEY_COUNT    18
+
+typedef enum {
+    KEY_LAYER_BASE,         // nhập số và phép toán
+    KEY_LAYER_SECONDARY,    // "..": một phím số chèn hàm rồi quay về
+    KEY_LAYER_TERTIARY,     // "**": con trỏ, lịch sử, tích phân, hàm người dùng
+    KEY_LAYER_PLOT,         // đồ thị: dịch và phóng to, phím khác để thoát
+    KEY_LAYER_COUNT,
+    KEY_LAYER_KEEP = 0xFF,  // giữ nguyên lớp hiện tại
+} key_layer_t;
+
+typedef enum {
+    KEY_UNBOUND = 0,        // không gán: bỏ qua phím (bảng tổ hợp: dùng bảng phím thường)
+    KEY_NOTHING,            // chỉ đổi lớp
+    KEY_OPERAND,            // chữ số hoặc ngoặc, bắt đầu biểu thức mới sau kết quả
+    KEY_DECIMAL,            // dấu thập phân, tối đa một dấu mỗi số
+    KEY_OPERATOR,           // + - * /, tiếp tục từ kết quả vừa tính
+    KEY_EVALUATE,           // '=': định nghĩa hàm, kết quả đã nhớ, hoặc tính ở task nền
+    KEY_CLEAR,              // xóa tất cả
+    KEY_SWITCH,             // bỏ ký tự do lần nhấn đầu của tổ hợp chèn vào (nếu có)
+    KEY_INSERT,             // chèn text tại con trỏ
+    KEY_CURSOR,             // dịch con trỏ arg ký tự
+    KEY_DELETE,             // xóa ký tự trước con trỏ
+    KEY_HISTORY,            // gọi lại lịch sử, nhấn tiếp để lùi về mục cũ hơn
+    KEY_INTEGRAL,           // chèn khung tích phân "[0,0]("
+    KEY_SAVED_RESULT,       // chèn kết quả vừa tính
+    KEY_ERROR_ESTIMATE,     // chèn sai số tích phân
+    KEY_USER_FUNC,          // chèn "f(", nhấn tiếp để đổi sang g, h
+    KEY_PLOT,               // vẽ đồ thị f trên [a,b] của biểu thức tích phân
+    KEY_TABLE,              // xuất bảng f(x) ra UART với "[start,end,step](f)"
+    KEY_PLOT_PAN,           // dịch cửa sổ đồ thị theo arg
+    KEY_PLOT_ZOOM,          // phóng to (arg = 1) hoặc thu nhỏ (arg = -1)
+    KEY_ACTION_COUNT,
+} key_action_t;
+
+#define KEY_FORGET  0x01    // không nhớ phím này: lần nhấn sau không thành tổ hợp
+
+typedef struct {
+    uint8_t action;         // key_action_t
+    uint8_t next;           // key_layer_t sau phím, hoặc KEY_LAYER_KEEP
+    uint8_t flags;
+    int8_t arg;
+    const char* text;       // chuỗi cho KEY_INSERT
+} key_binding_t;
+
+typedef struct {
+    key_binding_t keys[KEYMAP_KEY_COUNT];       // nhấn một lần
+    key_binding_t chords[KEYMAP_KEY_COUNT];     // cùng phím lần thứ hai liên tiếp
+} keymap_layer_t;
+
+int keymap_code(char key);  // mã phím 0..KEYMAP_KEY_COUNT-1, -1 nếu không có trong bảng
+
+const keymap_layer_t* keymap_get(key_layer_t layer);  // bảng đang dùng của một lớp
+
+void keymap_set(key_layer_t layer, const keymap_layer_t* map);  // thay bảng của lớp, NULL để về mặc định
@@ -0,0 +1,145 @@
+#include "calc-math.h"
+#include "trace.h"
+
+// Hàm tính giá trị tuyệt đối
+double my_fabs(double x) {
+    return (x < 0) ? -x : x;
+}
+
+// Hàm tính lũy thừa - ĐÃ CẬP NHẬT: Hỗ trợ số mũ thập phân
+// (bản không đo thời gian, dùng bên trong các hàm khác)
+static double pow_kernel(double base, double exponent) {
+    // Xử lý trường hợp đặc biệt
+    if (base == 0 && exponent > 0) return 0;
+    if (base == 0 && exponent <= 0) return 0.0/0.0; // NaN
+    if (exponent == 0) return 1.0;
+    
+    // Kiểm tra số mũ nguyên
+    int int_exp = (int)exponent;
+    if (int_exp == exponent) {
+        // Số mũ nguyên
+        double result = 1.0;
+        int abs_exp = (int_exp < 0) ? -int_exp : int_exp;
+        
+        for (int i = 0; i < abs_exp; i++) {
+            result *= base;
+        }
+        
+        return (int_exp < 0) ? 1.0 / result : result;
+    }
+    
+    // Số mũ thực: sử dụng exp(exponent * ln(base))
+    // Tính ln(base)
+    double z = (base - 1) / (base + 1);
+    double ln_base = 0.0;
+    int terms = 20;
+    for (int n = 0; n < terms; n++) {
+        double term = pow_kernel(z, 2 * n + 1) / (2 * n + 1);
+        ln_base += term;
+    }
+    ln_base *= 2;
+    
+    // Tính exponent * ln(base)
+    double product = exponent * ln_base;
+    
+    // Tính exp(product) bằng chuỗi Taylor
+    double exp_result = 1.0;
+    double term = 1.0;
+    for (int n = 1; n < 20; n++) {
+        term *= product / n;
+        exp_result += term;
+    }
+    
+    return exp_result;
+}
+
+double my_pow(double base, double exponent) {
+    TRACE_BEGIN(start);
+    double result = pow_kernel(base, exponent);
+    TRACE_END(TRACE_POW, start);
+    return result;
+}
+
+// Hàm tính giai thừa
+double factorial(int n) {
+    if (n == 0) return 1.0;
+    
+    double result = 1.0;
+    for (int i = 1; i <= n; i++) {
+        result *= i;
+    }
+    return result;
+}
+
+// Hàm tính sin sử dụng chuỗi Maclaurin (độ)
+double my_sin_deg(double x_deg) {
+    TRACE_BEGIN(start);
+    // Chuyển đổi độ sang radian
+    double x_rad = x_deg * PI / 180.0;
+    
+    // Chuẩn hóa góc về khoảng [0, 2π)
+    while (x_rad < 0) x_rad += 2 * PI;
+    while (x_rad >= 2 * PI) x_rad -= 2 * PI;
+    
+    double result = 0.0;
+    int terms = 20;
+    
+    for (int n = 0; n < terms; n++) {
+        double term = pow_kernel(-1, n) * pow_kernel(x_rad, 2 * n + 1) / factorial(2 * n + 1);
+        result += term;
+    }
+    TRACE_END(TRACE_SIN_DEG, start);
+    return result;
+}
+
+// Hàm tính sin sử dụng chuỗi Maclaurin (radian)
+double my_sin_rad(double x_rad) {
+    TRACE_BEGIN(start);
+    // Chuẩn hóa góc về khoảng [0, 2π)
+    while (x_rad < 0) x_rad += 2 * PI;
+    while (x_rad >= 2 * PI) x_rad -= 2 * PI;
+    
+    double result = 0.0;
+    int terms = 20;
+    
+    for (int n = 0; n < terms; n++) {
+        double term = pow_kernel(-1, n) * pow_kernel(x_rad, 2 * n + 1) / factorial(2 * n + 1);
+        result += term;
+    }
+    TRACE_END(TRACE_SIN_RAD, start);
+    return result;
+}
+
+// Hàm tính căn bậc 2
+double my_sqrt(double x) {
+    if (x < 0) return -1;
+    if (x == 0) return 0;
+    
+    double guess = x;
+    int iterations = 20;
+    
+    for (int i = 0; i < iterations; i++) {
+        double new_guess = 0.5 * (guess + x / guess);
+        if (my_fabs(new_guess - guess) < 1e-12) break;
+        guess = new_guess;
+    }
+    return guess;
+}
+
+// Hàm tính logarit tự nhiên
+double my_log(double x) {
+    if (x <= 0) return -1;
+    TRACE_BEGIN(start);
+    
+    double z = (x - 1) / (x + 1);
+    double result = 0.0;
+    int terms = 20;
+    
+    for (int n = 0; n < terms; n++) {
+        double term = pow_kernel(z, 2 * n + 1) / (2 * n + 1);
+        result += term;
+    }
+    
+    TRACE_END(TRACE_LOG, start);
+    return 2 * result;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// Hằng số toán học tự định nghĩa
+#define PI 3.14159265358979323846
+#define E 2.71828182845904523536
+
+double my_fabs(double x);                      // giá trị tuyệt đối
+
+double my_pow(double base, double exponent);   // lũy thừa (hỗ trợ số mũ thập phân)
+
+double factorial(int n);                       // giai thừa
+
+double my_sin_deg(double x_deg);               // sin theo độ
+
+double my_sin_rad(double x_rad);               // sin theo radian
+
+double my_sqrt(double x);                      // căn bậc 2
+
+double my_log(double x);                       // logarit tự nhiên
@@ -0,0 +1,214 @@
+#include "calc-poly.h"
+#include <stdlib.h>
+#include <string.h>
+#include "calc-math.h"
+
+// Phân tích đệ quy xuống cùng thứ tự ưu tiên với bc_compile: dấu trừ một ngôi
+// gắn chặt hơn '^', '^' kết hợp phải sang trái. Gặp hàm, biến khác x, chia cho
+// biểu thức chứa x hoặc cho 0 thì dừng với ok = 0 để bộ đánh giá thường xử lý
+// (và báo lỗi như cũ).
+typedef struct {
+    const char* ptr;
+    int ok;
+} poly_parser_t;
+
+static void skip_spaces(poly_parser_t* p) {
+    while (*p->ptr == ' ') p->ptr++;
+}
+
+static void poly_const(poly_t* poly, double value) {
+    poly->degree = 0;
+    poly->c[0] = value;
+}
+
+// Bỏ các hệ số bậc cao bằng 0, ví dụ sau x^2-x^2
+static void poly_trim(poly_t* poly) {
+    while (poly->degree > 0 && poly->c[poly->degree] == 0) poly->degree--;
+}
+
+static void poly_add(poly_t* a, const poly_t* b, double sign) {
+    for (int k = a->degree + 1; k <= b->degree; k++) a->c[k] = 0;
+    if (b->degree > a->degree) a->degree = b->degree;
+    for (int k = 0; k <= b->degree; k++) a->c[k] += sign * b->c[k];
+    poly_trim(a);
+}
+
+static void poly_mul(poly_parser_t* p, poly_t* a, const poly_t* b) {
+    if (a->degree + b->degree > POLY_MAX_DEGREE) {
+        p->ok = 0;
+        return;
+    }
+    poly_t product;
+    product.degree = a->degree + b->degree;
+    for (int k = 0; k <= product.degree; k++) product.c[k] = 0;
+    for (int i = 0; i <= a->degree; i++) {
+        for (int j = 0; j <= b->degree; j++) product.c[i + j] += a->c[i] * b->c[j];
+    }
+    *a = product;
+    poly_trim(a);
+}
+
+static void parse_sum(poly_parser_t* p, poly_t* out);
+
+// Đọc số như parse_number của bộ biên dịch bytecode: chữ số, dấu chấm, mũ 1E-3
+static void parse_number(poly_parser_t* p, poly_t* out) {
+    char token[24];
+    int len = 0;
+    while ((*p->ptr >= '0' && *p->ptr <= '9') || *p->ptr == '.') {
+        if (len < (int)sizeof(token) - 1) token[len++] = *p->ptr;
+        p->ptr++;
+    }
+    if (*p->ptr == 'E' || *p->ptr == 'e') {
+        const char* exp = p->ptr + 1;
+        if (*exp == '-') exp++;
+        if (*exp >= '0' && *exp <= '9') {
+            while (p->ptr < exp) {
+                if (len < (int)sizeof(token) - 1) token[len++] = *p->ptr;
+                p->ptr++;
+            }
+            while (*p->ptr >= '0' && *p->ptr <= '9') {
+                if (len < (int)sizeof(token) - 1) token[len++] = *p->ptr;
+                p->ptr++;
+            }
+        }
+    }
+    token[len] = '\0';
+    poly_const(out, atof(token));
+}
+
+static void parse_primary(poly_parser_t* p, poly_t* out) {
+    skip_spaces(p);
+    char c = *p->ptr;
+
+    if ((c >= '0' && c <= '9') || c == '.') {
+        parse_number(p, out);
+    } else if (c == 'x') {
+        p->ptr++;
+        out->degree = 1;
+        out->c[0] = 0;
+        out->c[1] = 1;
+    } else if (strncmp(p->ptr, "pi", 2) == 0) {
+        p->ptr += 2;
+        poly_const(out, PI);
+    } else if (c == 'e') {
+        p->ptr++;
+        poly_const(out, E);
+    } else if (c == '(') {
+        p->ptr++;
+        parse_sum(p, out);
+        skip_spaces(p);
+        if (*p->ptr != ')') {
+            p->ok = 0;
+            return;
+        }
+        p->ptr++;
+    } else {
+        p->ok = 0; // hàm, hàm người dùng hoặc ký tự lạ
+    }
+}
+
+static void parse_unary(poly_parser_t* p, poly_t* out) {
+    skip_spaces(p);
+    if (*p->ptr == '-') {
+        p->ptr++;
+        parse_unary(p, out);
+        for (int k = 0; k <= out->degree; k++) out->c[k] = -out->c[k];
+        return;
+    }
+    parse_primary(p, out);
+}
+
+// Số mũ phải là hằng số: nguyên không âm thì nhân lặp, cơ số hằng thì dùng my_pow
+static void parse_power(poly_parser_t* p, poly_t* out) {
+    parse_unary(p, out);
+    skip_spaces(p);
+    if (!p->ok || *p->ptr != '^') return;
+    p->ptr++;
+
+    poly_t exponent;
+    parse_power(p, &exponent);
+    if (!p->ok) return;
+    if (exponent.degree != 0) {
+        p->ok = 0;
+        return;
+    }
+    double n = exponent.c[0];
+    if (out->degree == 0) {
+        out->c[0] = my_pow(out->c[0], n);
+        if (out->c[0] - out->c[0] != 0) p->ok = 0; // NaN hoặc vô cực (0^-1): để bộ đánh giá báo lỗi
+        return;
+    }
+    if (n < 0 || n != (int)n || n * out->degree > POLY_MAX_DEGREE) {
+        p->ok = 0;
+        return;
+    }
+    poly_t base = *out;
+    poly_const(out, 1);
+    for (int i = 0; i < (int)n && p->ok; i++) poly_mul(p, out, &base);
+}
+
+static void parse_term(poly_parser_t* p, poly_t* out) {
+    parse_power(p, out);
+    while (p->ok) {
+        skip_spaces(p);
+        char op = *p->ptr;
+        if (op != '*' && op != '/') break;
+        p->ptr++;
+        poly_t rhs;
+        parse_power(p, &rhs);
+        if (!p->ok) break;
+        if (op == '*') {
+            poly_mul(p, out, &rhs);
+        } else if (rhs.degree != 0 || rhs.c[0] == 0) {
+            p->ok = 0;
+        } else {
+            for (int k = 0; k <= out->degree; k++) out->c[k] /= rhs.c[0];
+        }
+    }
+}
+
+static void parse_sum(poly_parser_t* p, poly_t* out) {
+    parse_term(p, out);
+    while (p->ok) {
+        skip_spaces(p);
+        char op = *p->ptr;
+        if (op != '+' && op != '-') break;
+        p->ptr++;
+        poly_t rhs;
+        parse_term(p, &rhs);
+        if (p->ok) poly_add(out, &rhs, op == '+' ? 1.0 : -1.0);
+    }
+}
+
+const char* poly_parse(const char* src, poly_t* poly) {
+    poly_parser_t p = { .ptr = src, .ok = 1 };
+    parse_sum(&p, poly);
+    skip_spaces(&p);
+    if (!p.ok || (*p.ptr != ')' && *p.ptr != '\0')) return NULL;
+    return p.ptr;
+}
+
+int poly_from_expr(const char* src, poly_t* poly) {
+    const char* end = poly_parse(src, poly);
+    return end != NULL && *end == '\0';
+}
+
+// Horner: bậc n chỉ cần n phép nhân và n phép cộng. ESP32 tính double bằng phần
+// mềm nên số phép nhân quyết định tốc độ, không dùng Estrin (nhiều phép nhân hơn).
+double poly_horner(const double* c, int degree, double x) {
+    double y = c[degree];
+    for (int k = degree - 1; k >= 0; k--) y = y * x + c[k];
+    return y;
+}
+
+double poly_eval(const poly_t* poly, double x) {
+    return poly_horner(poly->c, poly->degree, x);
+}
+
+// Nguyên hàm F(x) = x * (c0 + c1/2 x + ... + cn/(n+1) x^n), tích phân = F(b) - F(a)
+double poly_integrate(const poly_t* poly, double a, double b) {
+    double antiderivative[POLY_MAX_DEGREE + 1] = {0};
+    for (int k = 0; k <= poly->degree; k++) antiderivative[k] = poly->c[k] / (k + 1);
+    return b * poly_horner(antiderivative, poly->degree, b) -
+           a * poly_horner(antiderivative, poly->degree, a);
+}
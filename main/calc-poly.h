@@ -0,0 +1,22 @@
+#pragma once
+
+// Nhận dạng đa thức theo x: biểu thức chỉ gồm số, pi, e, x, + - * /, ngoặc và
+// lũy thừa với số mũ nguyên được gom thành các hệ số một lần, sau đó mỗi mẫu
+// chỉ cần một vòng Horner và tích phân được tính đúng từ nguyên hàm.
+
+#define POLY_MAX_DEGREE     8       // bậc lớn nhất nhận dạng, bậc cao hơn để bộ đánh giá thường
+
+typedef struct {
+    int degree;
+    double c[POLY_MAX_DEGREE + 1];  // c[k] là hệ số của x^k
+} poly_t;
+
+const char* poly_parse(const char* src, poly_t* poly);  // đọc tới ')' hoặc hết chuỗi, trả về vị trí dừng, NULL nếu không phải đa thức
+
+int poly_from_expr(const char* src, poly_t* poly);  // cả chuỗi là một đa thức: 1, ngược lại 0
+
+double poly_horner(const double* c, int degree, double x);  // giá trị của c[0] + c[1]x + ... tại x
+
+double poly_eval(const poly_t* poly, double x);  // giá trị đa thức tại x
+
+double poly_integrate(const poly_t* poly, double a, double b);  // tích phân đúng trên [a,b]
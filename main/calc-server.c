@@ -0,0 +1,170 @@
+#include "calc-server.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "calc-eval.h"
+#include "user-func.h"
+#include "trace.h"
+#include "math-bench.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <time.h>
+#endif
+
+#define SERVER_EXPR_MAX     80      // bằng kích thước display_buffer
+#define SERVER_CHUNK_US     20000   // thời gian tính tích phân tối đa trước khi nhường CPU
+#define SERVER_CHUNK_POINTS 4       // số điểm giữa hai lần xem đồng hồ
+
+static server_stats_t stats;
+
+int64_t server_now_us(void) {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+// Tích phân chia đoạn như task nền của bàn phím: sau mỗi đoạn SERVER_CHUNK_US
+// nhường CPU một tick để giao diện, LCD và task IDLE (watchdog) được chạy
+static void server_integral(const char* expr, char* result, size_t result_size, char* error, size_t error_size) {
+    static integral_job_t job; // lớn, không đặt trên ngăn xếp; chỉ task tính của server dùng
+    const char* parse_error = integral_begin(&job, expr);
+    if (parse_error) {
+        snprintf(result, result_size, "%s", parse_error);
+        error[0] = '\0';
+        return;
+    }
+
+    int done = 0;
+    while (!done) {
+        int64_t chunk_end = server_now_us() + SERVER_CHUNK_US;
+        while (!done && server_now_us() < chunk_end) {
+            done = integral_step(&job, SERVER_CHUNK_POINTS);
+        }
+#ifdef ESP_PLATFORM
+        if (!done) vTaskDelay(1);
+#endif
+    }
+    integral_finish(&job, result, result_size, error, error_size);
+}
+
+// Tính một biểu thức; trả về mã lỗi và ghi kết quả (hoặc thông báo lỗi) vào text
+static server_code_t server_evaluate(const char* expr, char* text, size_t size) {
+    if (user_func_is_definition(expr)) {
+        bc_status_t status = user_func_define(expr);
+        if (status != BC_OK) {
+            snprintf(text, size, "%s", bc_status_str(status));
+            return SERVER_ERR_DEFINE;
+        }
+        snprintf(text, size, "Saved %c(x)", expr[0]);
+        return SERVER_OK;
+    }
+
+    if (expr[0] == '[') {
+        char result[40], error[40];
+        server_integral(expr, result, sizeof(result), error, sizeof(error));
+        if (error[0] == '\0') {
+            snprintf(text, size, "%s", result);
+            return SERVER_ERR_INTEGRAL;
+        }
+        snprintf(text, size, "%s %s", result, error);
+        return SERVER_OK;
+    }
+
+    evaluate_expression_to(expr, text, size);
+    return strstr(text, "Error") ? SERVER_ERR_EVAL : SERVER_OK;
+}
+
+// snprintf trả về độ dài mong muốn; cắt về độ dài thực sự đã ghi
+static int written(int len, size_t size) {
+    return (len < (int)size) ? len : (int)size - 1;
+}
+
+int server_handle_line(const char* line, int truncated, char* response, size_t size) {
+    char expr[SERVER_LINE_MAX];
+    size_t len = strcspn(line, "\r\n");
+    if (len >= sizeof(expr)) len = sizeof(expr) - 1;
+    memcpy(expr, line, len);
+    expr[len] = '\0';
+
+    if (len == 0) return 0;
+    if (expr[0] == '#') {
+        if (strcmp(expr, "#stats") == 0) {
+            return written(snprintf(response, size, "STATS %u %u %lld\n",
+                                    (unsigned)stats.requests, (unsigned)stats.errors,
+                                    (long long)stats.busy_us), size);
+        }
+#ifdef CONFIG_CALC_TRACE
+        // "#trace" liệt kê số giai đoạn, "#trace <i>" trả một giai đoạn (chu kỳ CPU),
+        // "#trace reset" xóa số liệu
+        if (strncmp(expr, "#trace", 6) == 0) {
+            char line[96];
+            if (strcmp(expr + 6, " reset") == 0) {
+                trace_reset();
+                return written(snprintf(response, size, "TRACE reset\n"), size);
+            }
+            if (expr[6] == '\0') {
+                return written(snprintf(response, size, "TRACE %d name count min avg p99 max\n",
+                                        TRACE_STAGE_COUNT), size);
+            }
+            int stage = atoi(expr + 6);
+            if (trace_format(stage, line, sizeof(line)) < 0) {
+                return written(snprintf(response, size, "TRACE %d -\n", stage), size);
+            }
+            return written(snprintf(response, size, "TRACE %d %s\n", stage, line), size);
+        }
+#endif
+#ifdef CONFIG_CALC_MATH_BENCH
+        // "#math" liệt kê số trường hợp, "#math <i>" chạy một trường hợp (chu kỳ CPU
+        // mỗi lần gọi, sai số theo ULP). Chạy ngay trong task này, chặn vài trăm ms.
+        if (strncmp(expr, "#math", 5) == 0) {
+            char line[128];
+            math_bench_result_t result;
+            if (expr[5] == '\0') {
+                return written(snprintf(response, size, "MATH %d " MATH_BENCH_COLUMNS "\n",
+                                        math_bench_count()), size);
+            }
+            int index = atoi(expr + 5);
+            if (math_bench_run(index, &result) < 0) {
+                return written(snprintf(response, size, "MATH %d -\n", index), size);
+            }
+            math_bench_format(&result, line, sizeof(line));
+            return written(snprintf(response, size, "MATH %d %s\n", index, line), size);
+        }
+#endif
+        return 0;
+    }
+
+    uint32_t seq = ++stats.requests;
+    char text[80];
+    server_code_t code;
+
+    int64_t start = server_now_us();
+    if (truncated || len >= SERVER_EXPR_MAX) {
+        snprintf(text, sizeof(text), "Line too long");
+        code = SERVER_ERR_TOO_LONG;
+    } else {
+        code = server_evaluate(expr, text, sizeof(text));
+    }
+    int64_t elapsed = server_now_us() - start;
+    stats.busy_us += elapsed;
+
+    if (code != SERVER_OK) {
+        stats.errors++;
+        return written(snprintf(response, size, "ERR %u %d %lld %s\n",
+                                (unsigned)seq, code, (long long)elapsed, text), size);
+    }
+    return written(snprintf(response, size, "OK %u %lld %s\n",
+                            (unsigned)seq, (long long)elapsed, text), size);
+}
+
+void server_get_stats(server_stats_t* out) {
+    *out = stats;
+}
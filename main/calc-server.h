@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SERVER_LINE_MAX     128     // độ dài tối đa một dòng yêu cầu (kể cả '\0')
+#define SERVER_RESPONSE_MAX 160     // độ dài tối đa một dòng trả lời
+
+// Mã lỗi trả về trong dòng "ERR"
+typedef enum {
+    SERVER_OK = 0,
+    SERVER_ERR_EVAL = 1,        // lỗi khi tính ("Error: ...")
+    SERVER_ERR_INTEGRAL = 2,    // cú pháp "[a,b](f)" sai
+    SERVER_ERR_TOO_LONG = 3,    // dòng vượt quá bộ đệm biểu thức
+    SERVER_ERR_DEFINE = 4,      // định nghĩa "f(x):..." không biên dịch được
+} server_code_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t errors;
+    int64_t busy_us;            // tổng thời gian tính toán
+} server_stats_t;
+
+// Xử lý một dòng yêu cầu và ghi dòng trả lời (kết thúc bằng '\n') vào response.
+// Trả về độ dài trả lời, 0 nếu dòng trống hoặc là chú thích '#'.
+int server_handle_line(const char* line, int truncated, char* response, size_t size);
+
+void server_get_stats(server_stats_t* stats);  // số liệu tích lũy từ lúc khởi động
+
+int64_t server_now_us(void);  // đồng hồ micro giây của nền tảng (esp_timer hoặc CLOCK_MONOTONIC)
@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "calc-ui.h"
+#include "calc-keymap.h"
+#include "calc-eval.h"
+#include "user-func.h"
+#include "lcd-plot.h"
+#include "expr-history.h"
+#include "async-log.h"
+#include "trace.h"
+
+static const char *TAG = "CALC";
+
+// Biến toàn cục
+char display_buffer[80] = "";      // Bộ đệm biểu thức
+char result_str[40] = "";          // Bộ đệm kết quả chính
+char error_str[40] = "";           // Bộ đệm sai số cho tích phân
+int showing_result = 0;            // Cờ hiển thị kết quả (1 = true, 0 = false)
+char last_key = '\0';              // Phím vừa xử lý, '\0' sau một tổ hợp
+int key_layer = KEY_LAYER_BASE;    // Lớp bàn phím hiện tại (key_layer_t)
+int display_offset = 0;            // Vị trí bắt đầu hiển thị
+int cursor_pos = 0;                // Vị trí con trỏ trong chuỗi
+char last_input[80] = "";          // Lưu biểu thức vừa nhập
+char saved_result[40] = "";        // Lưu kết quả vừa tính
+int history_index = 0;             // Mục lịch sử đang được gọi lại (0 = mới nhất)
+int history_recalled = 0;          // Vừa gọi lại lịch sử, dòng 2 hiện kết quả đã nhớ
+int eval_running = 0;              // Đang chờ kết quả từ task tính toán nền
+int eval_cancelled = 0;            // Đã yêu cầu hủy, bỏ qua kết quả trả về
+int eval_percent = 0;              // Tiến độ tích phân (0-100)
+char eval_estimate[40] = "";       // Giá trị tạm thời của tích phân
+int64_t eval_start_us = 0;         // Thời điểm gửi phép tính, để đo thời gian ra kết quả
+char deferred_keys[UI_DEFER_LEN]; // Phím nhấn trong lúc đang tính, xử lý sau khi có kết quả
+int deferred_count = 0;
+static int key_inserted = 0;       // Phím đang xử lý đã chèn chính ký tự của nó vào biểu thức
+static int last_key_inserted = 0;  // Như trên cho phím trước: tổ hợp chỉ xóa ký tự khi cờ này bật
+
+// Hàm chèn ký tự tại vị trí con trỏ - trả về 0 nếu biểu thức đã đầy
+int insert_char_at_cursor(char c) {
+    size_t len = strlen(display_buffer);
+    if (len >= sizeof(display_buffer) - 1) return 0;
+    
+    if (cursor_pos < len) {
+        memmove(&display_buffer[cursor_pos+1], &display_buffer[cursor_pos], len - cursor_pos);
+    }
+    display_buffer[cursor_pos] = c;
+    display_buffer[len+1] = '\0';
+    cursor_pos++;
+    return 1;
+}
+
+// Hàm chèn chuỗi tại vị trí con trỏ
+void insert_string_at_cursor(const char* str) {
+    size_t len = strlen(display_buffer);
+    size_t str_len = strlen(str);
+    
+    if (len + str_len >= sizeof(display_buffer)) return;
+    
+    // Dời các ký tự phía sau để chèn
+    if (cursor_pos < len) {
+        memmove(&display_buffer[cursor_pos+str_len], &display_buffer[cursor_pos], len - cursor_pos);
+    }
+    
+    // Chèn chuỗi
+    memcpy(&display_buffer[cursor_pos], str, str_len);
+    display_buffer[len + str_len] = '\0';
+    cursor_pos += str_len;
+}
+
+// Xóa toàn bộ biểu thức, kết quả và các chế độ nhập
+void clear_calculator() {
+    display_buffer[0] = '\0';
+    result_str[0] = '\0';
+    error_str[0] = '\0';
+    showing_result = 0; // false
+    last_key = '\0';
+    key_layer = KEY_LAYER_BASE;
+    cursor_pos = 0;
+    display_offset = 0;
+    ALOGI(TAG, "Cleared");
+}
+
+// Gửi biểu thức, tích phân hoặc bảng cho task tính toán nền, kết quả về qua worker_poll
+void start_evaluation(worker_job_t job, const char* expr) {
+    if (!worker_submit(job, expr)) {
+        strcpy(result_str, "Busy");
+        error_str[0] = '\0';
+        showing_result = 1; // true
+        return;
+    }
+    eval_running = 1; // true
+    eval_cancelled = 0; // false
+    eval_start_us = esp_timer_get_time();
+    eval_percent = 0;
+    eval_estimate[0] = '\0';
+    result_str[0] = '\0';
+    error_str[0] = '\0';
+}
+
+// Nhận kết quả từ task tính toán nền
+void finish_evaluation(const worker_msg_t* msg) {
+    eval_running = 0; // false
+    if (eval_cancelled || msg->type == WORKER_CANCELLED) {
+        ALOGI(TAG, "Evaluation cancelled: %s", msg->expr);
+        return;
+    }
+    strcpy(result_str, msg->result);
+    strcpy(error_str, msg->error);
+    showing_result = 1; // true
+    cursor_pos = strlen(display_buffer);
+    ALOGI(TAG, "Result: %s (%lld us)", result_str, (long long)(esp_timer_get_time() - eval_start_us));
+    if (msg->job == WORKER_JOB_TABLE) {
+        return; // bảng không phải kết quả: không vào lịch sử, không lưu làm Ans
+    }
+    history_add(msg->expr, result_str, error_str);
+
+    // Lưu kết quả thành công
+    if (strstr(result_str, "Error") == NULL && strstr(result_str, "Invalid") == NULL) {
+        strcpy(saved_result, result_str);
+    }
+    if (msg->expr[0] == '[') {
+        ALOGI(TAG, "Error Estimate: %s", error_str);
+    }
+}
+
+// Phím nhấn khi đang tính: giữ lại để xử lý sau, riêng '/' hai lần liên tiếp thì hủy
+void defer_key(char key) {
+    if (key == '/' && deferred_count > 0 && deferred_keys[deferred_count - 1] == '/') {
+        worker_cancel();
+        eval_cancelled = 1; // true
+        deferred_count = 0;
+        clear_calculator();
+        return;
+    }
+    if (deferred_count < UI_DEFER_LEN) {
+        deferred_keys[deferred_count++] = key;
+    } else {
+        ALOGW(TAG, "Key %c dropped while evaluating", key);
+    }
+}
+
+// Các hành động của bản đồ phím (calc-keymap.c). Mỗi hàm nhận phím vừa nhấn
+// và ô của bảng; last_key lúc gọi vẫn là phím trước đó.
+
+// Chữ số hoặc ngoặc: sau kết quả thì bắt đầu biểu thức mới
+static void key_operand(char key, const key_binding_t* binding) {
+    if (showing_result) {
+        display_buffer[0] = key;
+        display_buffer[1] = '\0';
+        showing_result = 0; // false
+        cursor_pos = 1;
+        key_inserted = 1; // true
+    } else if (cursor_pos == strlen(display_buffer)) {
+        size_t len = strlen(display_buffer);
+        if (len < sizeof(display_buffer) - 1) {
+            display_buffer[len] = key;
+            display_buffer[len + 1] = '\0';
+            cursor_pos++;
+            key_inserted = 1; // true
+        }
+    } else {
+        key_inserted = insert_char_at_cursor(key);
+    }
+}
+
+// Dấu thập phân, chỉ khi số đang nhập chưa có dấu
+static void key_decimal(char key, const key_binding_t* binding) {
+    if (showing_result) {
+        strcpy(display_buffer, ".");
+        showing_result = 0; // false
+        cursor_pos = 1;
+        key_inserted = 1; // true
+        return;
+    }
+    size_t len = strlen(display_buffer);
+    for (int i = len - 1; i >= 0; i--) {
+        if (display_buffer[i] == '.') return;
+        if (display_buffer[i] < '0' || display_buffer[i] > '9') break;
+    }
+    if (cursor_pos == len) {
+        if (len < sizeof(display_buffer) - 1) {
+            display_buffer[len] = '.';
+            display_buffer[len + 1] = '\0';
+            cursor_pos++;
+            key_inserted = 1; // true
+        }
+    } else {
+        key_inserted = insert_char_at_cursor('.');
+    }
+}
+
+// Phép toán: sau kết quả thì tính tiếp từ kết quả đó
+static void key_operator(char key, const key_binding_t* binding) {
+    if (showing_result) {
+        strcpy(display_buffer, result_str);
+        cursor_pos = strlen(display_buffer);
+        showing_result = 0; // false
+    }
+    if (cursor_pos == strlen(display_buffer)) {
+        size_t len = strlen(display_buffer);
+        if (len < sizeof(display_buffer) - 1) {
+            display_buffer[len] = key;
+            display_buffer[len + 1] = '\0';
+            cursor_pos++;
+            key_inserted = 1; // true
+        }
+    } else {
+        key_inserted = insert_char_at_cursor(key);
+    }
+}
+
+static void key_evaluate(char key, const key_binding_t* binding) {
+    if (!strlen(display_buffer)) return;
+    strncpy(last_input, display_buffer, sizeof(last_input));
+    last_input[sizeof(last_input) - 1] = '\0';
+
+    history_entry_t cached;
+
+    if (user_func_is_definition(display_buffer)) {
+        // Định nghĩa hàm "f(x):thân" - biên dịch một lần và lưu vào NVS; lịch
+        // sử tự bỏ kết quả nhớ của f/g/h qua hook của user_func_define
+        bc_status_t status = user_func_define(display_buffer);
+        if (status == BC_OK) {
+            snprintf(result_str, sizeof(result_str), "Saved %c(x)", display_buffer[0]);
+        } else {
+            strcpy(result_str, bc_status_str(status));
+        }
+        error_str[0] = '\0';
+        showing_result = 1; // true
+        cursor_pos = strlen(display_buffer);
+    } else if (history_lookup(display_buffer, &cached)) {
+        // Biểu thức chưa bị sửa kể từ lần tính trước: dùng lại kết quả đã nhớ
+        strcpy(result_str, cached.result);
+        strcpy(error_str, cached.error);
+        if (strstr(result_str, "Error") == NULL && strstr(result_str, "Invalid") == NULL) {
+            strcpy(saved_result, result_str);
+        }
+        showing_result = 1; // true
+        cursor_pos = strlen(display_buffer);
+    } else {
+        // Biểu thức và tích phân tính ở task nền, dòng 2 hiện tiến độ
+        start_evaluation(WORKER_JOB_EVAL, display_buffer);
+        cursor_pos = strlen(display_buffer);
+    }
+}
+
+static void key_clear(char key, const key_binding_t* binding) {
+    clear_calculator();
+}
+
+// Tổ hợp đổi lớp: nếu lần nhấn đầu đã chèn phím vào biểu thức như bình thường
+// thì bỏ nó đi. Lần nhấn đầu có thể không chèn gì ("3." rồi ".."), khi đó ký
+// tự trước con trỏ là của người dùng và phải giữ lại.
+static void key_switch(char key, const key_binding_t* binding) {
+    if (last_key_inserted && cursor_pos > 0 && display_buffer[cursor_pos-1] == key) {
+        memmove(&display_buffer[cursor_pos-1], &display_buffer[cursor_pos],
+                strlen(display_buffer) - cursor_pos + 1);
+        cursor_pos--;
+    }
+}
+
+static void key_insert(char key, const key_binding_t* binding) {
+    insert_string_at_cursor(binding->text);
+}
+
+// Di chuyển con trỏ, cửa sổ hiển thị bám theo
+static void key_cursor(char key, const key_binding_t* binding) {
+    if (binding->arg < 0 && cursor_pos > 0) {
+        cursor_pos--;
+        if (cursor_pos < display_offset) {
+            display_offset = cursor_pos;
+        }
+    } else if (binding->arg > 0 && cursor_pos < strlen(display_buffer)) {
+        cursor_pos++;
+        if (cursor_pos > display_offset + 15) {
+            display_offset = cursor_pos - 15;
+        }
+    }
+}
+
+// Xóa ký tự tại vị trí trước con trỏ
+static void key_delete(char key, const key_binding_t* binding) {
+    if (cursor_pos > 0 && cursor_pos <= strlen(display_buffer)) {
+        memmove(&display_buffer[cursor_pos-1],
+                &display_buffer[cursor_pos],
+                strlen(display_buffer) - cursor_pos + 1);
+        cursor_pos--;
+        if (cursor_pos < display_offset) {
+            display_offset = cursor_pos;
+        }
+    }
+}
+
+// Phục hồi biểu thức trước đó, nhấn tiếp để lùi về các mục cũ hơn
+static void key_history(char key, const key_binding_t* binding) {
+    history_index = (last_key == key) ? history_index + 1 : 0;
+    history_entry_t entry;
+    int found = history_get(history_index, &entry);
+    if (!found) {
+        history_index = 0;
+        found = history_get(0, &entry);
+    }
+    if (found) {
+        // Hiện ngay kết quả đã nhớ, chỉ tính lại khi biểu thức bị sửa
+        strcpy(display_buffer, entry.expr);
+        strcpy(result_str, entry.result);
+        strcpy(error_str, entry.error);
+        cursor_pos = strlen(display_buffer);
+        showing_result = (entry.result[0] != '\0');
+        history_recalled = showing_result;
+    } else if (strlen(last_input)) {
+        strcpy(display_buffer, last_input);
+        cursor_pos = strlen(display_buffer);
+        showing_result = 0; // false
+    }
+}
+
+// Khung tích phân, con trỏ đứng trước '(' để sửa cận
+static void key_integral(char key, const key_binding_t* binding) {
+    insert_string_at_cursor("[0,0](");
+    cursor_pos = strlen(display_buffer) - 1;
+}
+
+static void key_saved_result(char key, const key_binding_t* binding) {
+    if (strlen(saved_result)) {
+        insert_string_at_cursor(saved_result);
+    }
+}
+
+static void key_error_estimate(char key, const key_binding_t* binding) {
+    if (strlen(error_str)) {
+        insert_string_at_cursor(error_str + 2); // Bỏ qua "R:"
+    }
+}
+
+// Chèn hàm người dùng "f(", nhấn tiếp để đổi sang g, h
+static void key_user_func(char key, const key_binding_t* binding) {
+    if (last_key == key && cursor_pos >= 2 && display_buffer[cursor_pos-1] == '(') {
+        const char* name = strchr(BC_USER_FUNC_NAMES, display_buffer[cursor_pos-2]);
+        if (name != NULL && *name != '\0') {
+            display_buffer[cursor_pos-2] = name[1] ? name[1] : BC_USER_FUNC_NAMES[0];
+            return;
+        }
+    }
+    char call[3] = { BC_USER_FUNC_NAMES[0], '(', '\0' };
+    insert_string_at_cursor(call);
+}
+
+// Vẽ đồ thị f(x) trên [a,b] của biểu thức tích phân
+static void key_plot(char key, const key_binding_t* binding) {
+    if (display_buffer[0] != '[') return;
+    double a, b;
+    char f_expr[60];
+    const char* parse_error = parse_integral_spec(display_buffer, &a, &b, NULL, f_expr, sizeof(f_expr));
+    bc_status_t status = BC_OK;
+    if (parse_error == NULL) {
+        status = plot_open(f_expr, a, b);
+    }
+    if (parse_error == NULL && status == BC_OK) {
+        key_layer = KEY_LAYER_PLOT;
+    } else {
+        key_layer = KEY_LAYER_BASE;
+        strcpy(result_str, parse_error ? parse_error : bc_status_str(status));
+        error_str[0] = '\0';
+        showing_result = 1; // true
+    }
+}
+
+// Xuất bảng f(x) dạng CSV ra UART với "[start,end,step](f)": chạy trên task tính
+// toán nền như tích phân, hiện tiến độ và hủy được bằng "//"
+static void key_table(char key, const key_binding_t* binding) {
+    if (display_buffer[0] != '[') return;
+    start_evaluation(WORKER_JOB_TABLE, display_buffer);
+    key_layer = KEY_LAYER_BASE;
+}
+
+static void key_plot_pan(char key, const key_binding_t* binding) {
+    plot_pan(binding->arg);
+}
+
+static void key_plot_zoom(char key, const key_binding_t* binding) {
+    plot_zoom(binding->arg);
+}
+
+static void key_nothing(char key, const key_binding_t* binding) {
+}
+
+typedef void (*key_action_fn)(char key, const key_binding_t* binding);
+
+static const key_action_fn key_actions[KEY_ACTION_COUNT] = {
+    [KEY_UNBOUND] = key_nothing,
+    [KEY_NOTHING] = key_nothing,
+    [KEY_OPERAND] = key_operand,
+    [KEY_DECIMAL] = key_decimal,
+    [KEY_OPERATOR] = key_operator,
+    [KEY_EVALUATE] = key_evaluate,
+    [KEY_CLEAR] = key_clear,
+    [KEY_SWITCH] = key_switch,
+    [KEY_INSERT] = key_insert,
+    [KEY_CURSOR] = key_cursor,
+    [KEY_DELETE] = key_delete,
+    [KEY_HISTORY] = key_history,
+    [KEY_INTEGRAL] = key_integral,
+    [KEY_SAVED_RESULT] = key_saved_result,
+    [KEY_ERROR_ESTIMATE] = key_error_estimate,
+    [KEY_USER_FUNC] = key_user_func,
+    [KEY_PLOT] = key_plot,
+    [KEY_TABLE] = key_table,
+    [KEY_PLOT_PAN] = key_plot_pan,
+    [KEY_PLOT_ZOOM] = key_plot_zoom,
+};
+
+// Xử lý phím được nhấn: tra bảng của lớp hiện tại (tổ hợp nếu cùng phím hai
+// lần liên tiếp), đổi lớp rồi gọi hành động - không phụ thuộc số chế độ
+void handle_key(char key) {
+    int code = keymap_code(key);
+    if (code < 0) return;
+
+    const keymap_layer_t* map = keymap_get(key_layer);
+    const key_binding_t* binding = &map->chords[code];
+    if (key != last_key || binding->action == KEY_UNBOUND) {
+        binding = &map->keys[code];
+    }
+    if (binding->action == KEY_UNBOUND) return;
+
+    history_recalled = 0; // false
+    if (binding->next != KEY_LAYER_KEEP) {
+        key_layer = binding->next;
+    }
+    last_key_inserted = key_inserted;
+    key_inserted = 0; // false
+    key_actions[binding->action](key, binding);
+    last_key = (binding->flags & KEY_FORGET) ? '\0' : key;
+}
+
+// task hiển thị sẽ gửi các ô thay đổi
+void render_display(fb_screen_t* screen) {
+    fb_clear(screen);
+    if (key_layer == KEY_LAYER_PLOT) {
+        return; // task hiển thị tự vẽ đồ thị vào màn hình
+    }
+
+    char lcd_line[17];
+    
+    int len = strlen(display_buffer);
+    if (len > 16) {
+        if (cursor_pos < display_offset) {
+            display_offset = cursor_pos;
+        } else if (cursor_pos >= display_offset + 16) {
+            display_offset = cursor_pos - 15;
+        }
+    } else {
+        display_offset = 0;
+    }
+    // Nạp thêm vài ký tự hai bên cửa sổ: di chuyển con trỏ chỉ cần lệnh dịch màn hình
+    int left = display_offset < FB_MARGIN ? display_offset : FB_MARGIN;
+    fb_set_scroll(screen, display_offset);
+    fb_put_string(screen, 0, -left, display_buffer + display_offset - left);
+    
+    // Dòng 2
+    if (key_layer == KEY_LAYER_TERTIARY && !history_recalled) {
+        char cursor_line[17] = "                ";
+        int cursor_screen_pos = cursor_pos - display_offset;
+        if (cursor_screen_pos >= 0 && cursor_screen_pos < 16) {
+            cursor_line[cursor_screen_pos] = '^';
+        }
+        fb_put_string(screen, 1, 0, cursor_line);
+    } else if (eval_running && !eval_cancelled) {
+        // Đang tính: phần trăm và giá trị tạm thời của tích phân, hoặc số dòng của bảng
+        if (display_buffer[0] == '[') {
+            // Dòng LCD 16 ký tự: phần trăm (0-100) và tối đa 11 ký tự của giá trị tạm
+            snprintf(lcd_line, sizeof(lcd_line), "%3u%% %.11s", (unsigned)eval_percent % 1000, eval_estimate);
+        } else {
+            strcpy(lcd_line, "...");
+        }
+        fb_put_string(screen, 1, 0, lcd_line);
+    } else if (key_layer == KEY_LAYER_SECONDARY) {
+        fb_put_string(screen, 1, 0, "Secondary Mode");
+    } else if (showing_result) {
+        // Hiển thị kết quả tích phân
+        if (display_buffer[0] == '[' && strlen(error_str) > 0) {
+            
+            // Dòng 1: kết quả chính
+            strncpy(lcd_line, result_str, 16);
+            lcd_line[16] = '\0';
+            fb_clear(screen);
+            fb_put_string(screen, 0, 0, lcd_line);
+            // Dòng 2: sai số
+            fb_put_string(screen, 1, 0, error_str);
+        } else {
+            // Hiển thị kết quả thông thường
+            strncpy(lcd_line, result_str, 16);
+            lcd_line[16] = '\0';
+            fb_put_string(screen, 1, 0, lcd_line);
+        }
+    } else {
+        char cursor_line[17] = "                ";
+        int cursor_screen_pos = cursor_pos - display_offset;
+        if (cursor_screen_pos >= 0 && cursor_screen_pos < 16) {
+            cursor_line[cursor_screen_pos] = '_';
+        }
+        fb_put_string(screen, 1, 0, cursor_line);
+    }
+}
+
+// Phím từ bàn phím: khi task nền đang tính thì chỉ giữ lại (hoặc hủy), không chờ
+void ui_press_key(char key) {
+    if (eval_running) {
+        defer_key(key);
+        return;
+    }
+    TRACE_BEGIN(start);
+    handle_key(key);
+    TRACE_END(TRACE_HANDLE_KEY, start);
+}
+
+// Nhận tiến độ và kết quả từ task tính toán nền, rồi xử lý tiếp các phím đã nhấn
+// trong lúc chờ (có thể lại bắt đầu một phép tính). Trả 1 nếu màn hình thay đổi.
+int ui_poll() {
+    int changed = 0; // false
+    worker_msg_t msg;
+    while (worker_poll(&msg)) {
+        if (msg.type == WORKER_PROGRESS) {
+            eval_percent = msg.percent;
+            strcpy(eval_estimate, msg.result);
+        } else {
+            finish_evaluation(&msg);
+        }
+        changed = 1; // true
+    }
+
+    int replayed = 0;
+    while (!eval_running && replayed < deferred_count) {
+        handle_key(deferred_keys[replayed++]);
+    }
+    if (replayed > 0) {
+        deferred_count -= replayed;
+        memmove(deferred_keys, deferred_keys + replayed, deferred_count);
+        changed = 1; // true
+    }
+    return changed;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include "lcd-fb.h"
+#include "calc-worker.h"
+#include "calc-keymap.h"
+
+// Máy trạng thái giao diện: phím -> biểu thức -> màn hình. Không phụ thuộc
+// phần cứng bàn phím/LCD nên chạy được cả trên host (bench phát lại phím).
+
+#define UI_DEFER_LEN    16      // số phím giữ lại trong lúc đang tính
+
+// Trạng thái soạn thảo (keypad.c lưu vào RTC khi deep sleep)
+extern char display_buffer[80];
+extern char result_str[40];
+extern char error_str[40];
+extern int showing_result;
+extern char last_key;
+extern int key_layer;              // key_layer_t, xem calc-keymap.h
+extern int display_offset;
+extern int cursor_pos;
+extern char last_input[80];
+extern char saved_result[40];
+extern int history_index;
+extern int history_recalled;
+extern int eval_running;
+
+void clear_calculator(void);  // xóa biểu thức, kết quả và các chế độ nhập
+
+void handle_key(char key);  // tra bản đồ phím và thực hiện, khi không có phép tính đang chạy
+
+void ui_press_key(char key);  // phím từ bàn phím: xử lý ngay, hoặc giữ lại nếu đang tính
+
+int ui_poll(void);  // nhận tiến độ/kết quả từ task tính, xử lý phím đã giữ; trả 1 nếu cần vẽ lại
+
+void render_display(fb_screen_t* screen);  // dựng 2 dòng LCD từ trạng thái hiện tại
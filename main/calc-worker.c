@@ -0,0 +1,176 @@
+#include "calc-worker.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "calc-eval.h"
+#include "uart-table.h"
+#include "async-log.h"
+
+static const char *TAG = "WORKER";
+
+#define WORKER_CHUNK_US     20000   // thời gian tối đa của một đoạn tính trước khi nhường CPU
+#define WORKER_CHUNK_POINTS 4       // số điểm giữa hai lần xem đồng hồ
+#define WORKER_MSG_LEN      4
+
+// Công việc trong hàng đợi: loại và biểu thức
+typedef struct {
+    worker_job_t job;
+    char expr[sizeof(((worker_msg_t*)0)->expr)];
+} worker_job_msg_t;
+
+static QueueHandle_t job_queue;     // giao diện -> worker: công việc
+static QueueHandle_t msg_queue;     // worker -> giao diện: tiến độ, kết quả
+static volatile int cancel_requested;
+static volatile int busy;
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+static esp_pm_lock_handle_t freq_lock; // giữ tần số tối đa trong lúc tính
+#endif
+
+static void post_done(worker_msg_t* msg) {
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+    esp_pm_lock_release(freq_lock);
+#endif
+    xQueueSend(msg_queue, msg, portMAX_DELAY);
+    busy = 0;
+}
+
+// Tích phân chia đoạn: mỗi đoạn chạy tối đa WORKER_CHUNK_US rồi báo tiến độ,
+// kiểm tra yêu cầu hủy và nhường CPU để task IDLE kịp nuôi watchdog
+static void run_integral(worker_msg_t* msg) {
+    static integral_job_t job; // lớn, không đặt trên ngăn xếp
+    const char* parse_error = integral_begin(&job, msg->expr);
+    if (parse_error) {
+        snprintf(msg->result, sizeof(msg->result), "%s", parse_error);
+        msg->error[0] = '\0';
+        msg->type = WORKER_DONE;
+        post_done(msg);
+        return;
+    }
+
+    int done = 0;
+    while (!done) {
+        int64_t chunk_end = esp_timer_get_time() + WORKER_CHUNK_US;
+        while (!done && esp_timer_get_time() < chunk_end) {
+            done = integral_step(&job, WORKER_CHUNK_POINTS);
+        }
+        if (cancel_requested) {
+            msg->type = WORKER_CANCELLED;
+            post_done(msg);
+            ALOGI(TAG, "Cancelled at %d%%", integral_percent(&job));
+            return;
+        }
+        if (!done) {
+            worker_msg_t progress = {.type = WORKER_PROGRESS, .job = WORKER_JOB_EVAL, .percent = integral_percent(&job)};
+            snprintf(progress.result, sizeof(progress.result), "%.6g", integral_estimate(&job));
+            xQueueSend(msg_queue, &progress, 0); // bỏ qua nếu giao diện chưa đọc kịp
+            vTaskDelay(1);
+        }
+    }
+    integral_finish(&job, msg->result, sizeof(msg->result), msg->error, sizeof(msg->error));
+    msg->type = WORKER_DONE;
+    post_done(msg);
+}
+
+// Bảng CSV chia đoạn như tích phân: mỗi lô chờ UART nhiều nhất một nửa bộ đệm
+// kép nên yêu cầu hủy vẫn có hiệu lực sau vài chục ms
+static void run_table(worker_msg_t* msg) {
+    static table_job_t job; // chứa chương trình bytecode, không đặt trên ngăn xếp
+    const char* error = table_begin(&job, msg->expr);
+    msg->error[0] = '\0';
+    if (error) {
+        snprintf(msg->result, sizeof(msg->result), "%s", error);
+        msg->type = WORKER_DONE;
+        post_done(msg);
+        return;
+    }
+
+    int done = 0;
+    while (!done) {
+        int64_t chunk_end = esp_timer_get_time() + WORKER_CHUNK_US;
+        while (!done && esp_timer_get_time() < chunk_end) {
+            done = table_step(&job);
+        }
+        if (cancel_requested) {
+            table_finish(&job);
+            msg->type = WORKER_CANCELLED;
+            post_done(msg);
+            ALOGI(TAG, "Table cancelled after %d rows", job.rows);
+            return;
+        }
+        if (!done) {
+            worker_msg_t progress = {.type = WORKER_PROGRESS, .job = WORKER_JOB_TABLE, .percent = table_percent(&job)};
+            snprintf(progress.result, sizeof(progress.result), "%d rows", job.rows);
+            xQueueSend(msg_queue, &progress, 0); // bỏ qua nếu giao diện chưa đọc kịp
+            vTaskDelay(1);
+        }
+    }
+    table_finish(&job);
+    snprintf(msg->result, sizeof(msg->result), "Table: %d rows", job.rows);
+    msg->type = WORKER_DONE;
+    post_done(msg);
+}
+
+static void worker_task(void* arg) {
+    static worker_msg_t msg;
+    worker_job_msg_t job;
+    while (1) {
+        xQueueReceive(job_queue, &job, portMAX_DELAY);
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+        esp_pm_lock_acquire(freq_lock);
+#endif
+        msg.job = job.job;
+        strcpy(msg.expr, job.expr);
+        msg.percent = 0;
+        if (job.job == WORKER_JOB_TABLE) {
+            run_table(&msg);
+        } else if (msg.expr[0] == '[') {
+            run_integral(&msg);
+        } else {
+            evaluate_expression_to(msg.expr, msg.result, sizeof(msg.result));
+            msg.error[0] = '\0';
+            msg.type = cancel_requested ? WORKER_CANCELLED : WORKER_DONE;
+            post_done(&msg);
+        }
+    }
+}
+
+void worker_start(void) {
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "calc_eval", &freq_lock) != ESP_OK) {
+        ALOGE(TAG, "Failed to create PM lock");
+        return;
+    }
+#endif
+    job_queue = xQueueCreate(1, sizeof(worker_job_msg_t));
+    msg_queue = xQueueCreate(WORKER_MSG_LEN, sizeof(worker_msg_t));
+    // Cùng mức ưu tiên với app_main: giao diện được chia thời gian, quét phím và
+    // LCD chạy ở mức cao hơn nên không bao giờ phải chờ phép tính
+    xTaskCreate(worker_task, "calc_worker", 8192, NULL, 1, NULL);
+}
+
+int worker_submit(worker_job_t job, const char* expr) {
+    if (busy) return 0;
+    worker_job_msg_t item = {.job = job};
+    strncpy(item.expr, expr, sizeof(item.expr));
+    item.expr[sizeof(item.expr) - 1] = '\0';
+    cancel_requested = 0;
+    busy = 1;
+    xQueueSend(job_queue, &item, 0);
+    return 1;
+}
+
+void worker_cancel(void) {
+    if (busy) cancel_requested = 1;
+}
+
+int worker_busy(void) {
+    return busy;
+}
+
+int worker_poll(worker_msg_t* msg) {
+    return xQueueReceive(msg_queue, msg, 0) == pdTRUE;
+}
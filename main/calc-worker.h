@@ -0,0 +1,33 @@
+#pragma once
+
+#define WORKER_POLL_MS  50      // chu kỳ giao diện kiểm tra tiến độ khi đang tính
+
+typedef enum {
+    WORKER_PROGRESS,            // đang tính: percent và estimate
+    WORKER_DONE,                // xong: result và error
+    WORKER_CANCELLED,           // đã hủy theo yêu cầu
+} worker_msg_type_t;
+
+typedef enum {
+    WORKER_JOB_EVAL,            // biểu thức hoặc tích phân "[a,b](f)"
+    WORKER_JOB_TABLE,           // bảng CSV "[start,end,step](f)" ra UART
+} worker_job_t;
+
+typedef struct {
+    worker_msg_type_t type;
+    worker_job_t job;
+    int percent;
+    char expr[80];              // biểu thức của công việc
+    char result[40];            // kết quả, hoặc giá trị tạm/số dòng khi PROGRESS
+    char error[40];             // sai số ước lượng "R:..." của tích phân
+} worker_msg_t;
+
+void worker_start(void);  // tạo task tính toán nền
+
+int worker_submit(worker_job_t job, const char* expr);  // gửi một công việc, trả 0 nếu đang bận
+
+void worker_cancel(void);  // yêu cầu dừng, có hiệu lực trong vòng một đoạn tính
+
+int worker_busy(void);  // đang có công việc chưa báo DONE/CANCELLED
+
+int worker_poll(worker_msg_t* msg);  // lấy thông báo tiến độ/kết quả, không chờ
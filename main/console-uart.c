@@ -0,0 +1,49 @@
+#include "console-uart.h"
+#include <stdio.h>
+#include "driver/uart.h"
+#include "esp_vfs_dev.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#define CONSOLE_UART CONFIG_ESP_CONSOLE_UART_NUM
+
+static SemaphoreHandle_t console_lock;
+
+int console_init(void) {
+    if (console_lock != NULL) return 0;
+
+    if (!uart_is_driver_installed(CONSOLE_UART) &&
+        uart_driver_install(CONSOLE_UART, CONSOLE_RX_BUF, 0, 0, NULL, 0) != ESP_OK) {
+        return -1;
+    }
+    // printf from ESP_LOG and the IDF itself would otherwise write the FIFO
+    // directly, behind the driver's back
+    esp_vfs_dev_uart_use_driver(CONSOLE_UART);
+
+    console_lock = xSemaphoreCreateMutex();
+    return console_lock != NULL ? 0 : -1;
+}
+
+void console_write(const char *data, int len) {
+    if (console_lock == NULL) {
+        fwrite(data, 1, len, stdout); // no driver (yet): the plain VFS path, as before
+        return;
+    }
+    xSemaphoreTake(console_lock, portMAX_DELAY);
+    uart_write_bytes(CONSOLE_UART, data, len);
+    xSemaphoreGive(console_lock);
+}
+
+void console_claim(void) {
+    xSemaphoreTake(console_lock, portMAX_DELAY);
+}
+
+void console_stream(const char *data, int len) {
+    uart_write_bytes(CONSOLE_UART, data, len);
+}
+
+void console_release(void) {
+    uart_wait_tx_done(CONSOLE_UART, portMAX_DELAY);
+    xSemaphoreGive(console_lock);
+}
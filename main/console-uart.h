@@ -0,0 +1,18 @@
+#pragma once
+
+// The one writer of the console UART. Log records, server replies and table
+// CSV all reach the port through here under a single mutex, so lines from
+// different tasks never interleave. A table stream claims the port for its
+// whole run and the other writers wait until it is released.
+
+#define CONSOLE_RX_BUF  1024    // driver RX ring, the console server reads through it
+
+int console_init(void);  // install the UART driver once and route stdout through it; 0 on success
+
+void console_write(const char *data, int len);  // write one whole record, waits while the port is claimed
+
+void console_claim(void);  // own the port across many writes (a table stream)
+
+void console_stream(const char *data, int len);  // write on behalf of the current claim, no locking
+
+void console_release(void);  // wait for the claimed output to leave the FIFO and let other writers in
@@ -0,0 +1,178 @@
+#include "expr-history.h"
+#include <stdio.h>
+#include <string.h>
+#include "nvs.h"
+#include "calc-bytecode.h"
+#include "user-func.h"
+#include "async-log.h"
+
+static const char *TAG = "HISTORY";
+
+#define HISTORY_FORMAT_VERSION 1
+
+// Vòng lịch sử trong RAM: head là vị trí ghi tiếp theo. Giao diện dùng vòng
+// này, còn định nghĩa hàm từ console bỏ kết quả nhớ ngay trên task server, nên
+// mọi hàm công khai giữ user_func_lock và chỉ trả bản sao ra ngoài.
+static history_entry_t entries[HISTORY_SIZE];
+static int head = 0;
+static int count = 0;
+
+// Trạng thái ghi gộp để giảm số lần ghi flash
+static int pending = 0;             // số mục chưa ghi xuống NVS
+static uint32_t last_change_ms = 0;
+static uint32_t last_tick_ms = 0;
+
+static history_entry_t* entry_at(int index) {
+    return &entries[(head - 1 - index + HISTORY_SIZE) % HISTORY_SIZE];
+}
+
+// Blob nén: [phiên bản][số mục] rồi "expr\0result\0error\0" từ cũ đến mới
+static size_t pack(uint8_t* blob, size_t size) {
+    size_t len = 0;
+    blob[len++] = HISTORY_FORMAT_VERSION;
+    blob[len++] = count;
+    for (int i = count - 1; i >= 0; i--) {
+        const history_entry_t* entry = entry_at(i);
+        const char* fields[3] = { entry->expr, entry->result, entry->error };
+        for (int f = 0; f < 3; f++) {
+            size_t field_len = strlen(fields[f]) + 1;
+            if (len + field_len > size) return 0;
+            memcpy(blob + len, fields[f], field_len);
+            len += field_len;
+        }
+    }
+    return len;
+}
+
+static void unpack(const uint8_t* blob, size_t len) {
+    if (len < 2 || blob[0] != HISTORY_FORMAT_VERSION) return;
+    int stored = blob[1];
+    size_t pos = 2;
+    for (int i = 0; i < stored; i++) {
+        const char* fields[3];
+        for (int f = 0; f < 3; f++) {
+            if (pos >= len) return;
+            const char* end = memchr(blob + pos, '\0', len - pos);
+            if (end == NULL) return;
+            fields[f] = (const char*)blob + pos;
+            pos = (const uint8_t*)end - blob + 1;
+        }
+        history_add(fields[0], fields[1], fields[2]);
+    }
+}
+
+void history_init(void) {
+    nvs_handle_t handle;
+    uint8_t blob[2 + HISTORY_SIZE * sizeof(history_entry_t)];
+    size_t len = sizeof(blob);
+
+    if (nvs_open(HISTORY_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ALOGE(TAG, "Cannot open NVS namespace");
+        return;
+    }
+    if (nvs_get_blob(handle, "ring", blob, &len) == ESP_OK) {
+        unpack(blob, len);
+    }
+    nvs_close(handle);
+    pending = 0;
+    user_func_on_define(history_forget_user_funcs);
+}
+
+void history_add(const char* expr, const char* result, const char* error) {
+    user_func_lock();
+    history_entry_t* entry = &entries[head];
+    snprintf(entry->expr, sizeof(entry->expr), "%s", expr);
+    snprintf(entry->result, sizeof(entry->result), "%s", result);
+    snprintf(entry->error, sizeof(entry->error), "%s", error);
+
+    head = (head + 1) % HISTORY_SIZE;
+    if (count < HISTORY_SIZE) count++;
+    pending++;
+    last_change_ms = last_tick_ms;
+    user_func_unlock();
+}
+
+int history_get(int index, history_entry_t* out) {
+    int found = 0;
+    user_func_lock();
+    if (index >= 0 && index < count) {
+        *out = *entry_at(index);
+        found = 1;
+    }
+    user_func_unlock();
+    return found;
+}
+
+int history_lookup(const char* expr, history_entry_t* out) {
+    int found = 0;
+    user_func_lock();
+    for (int i = 0; i < count && !found; i++) {
+        const history_entry_t* entry = entry_at(i);
+        if (entry->result[0] != '\0' && strcmp(entry->expr, expr) == 0) {
+            *out = *entry;
+            found = 1;
+        }
+    }
+    user_func_unlock();
+    return found;
+}
+
+void history_forget_user_funcs(void) {
+    user_func_lock();
+    for (int i = 0; i < count; i++) {
+        history_entry_t* entry = entry_at(i);
+        for (const char* p = entry->expr; *p; p++) {
+            if (p[1] == '(' && strchr(BC_USER_FUNC_NAMES, *p)) {
+                entry->result[0] = '\0';
+                entry->error[0] = '\0';
+                pending++;
+                break;
+            }
+        }
+    }
+    user_func_unlock();
+}
+
+void history_clear(void) {
+    user_func_lock();
+    head = 0;
+    count = 0;
+    pending++;
+    last_change_ms = last_tick_ms;
+    user_func_unlock();
+}
+
+void history_tick(uint32_t now_ms) {
+    user_func_lock();
+    last_tick_ms = now_ms;
+    int due = pending > 0 &&
+              (pending >= HISTORY_FLUSH_EVERY || now_ms - last_change_ms >= HISTORY_FLUSH_IDLE_MS);
+    user_func_unlock();
+    if (due) history_flush();
+}
+
+void history_flush(void) {
+    nvs_handle_t handle;
+    uint8_t blob[2 + HISTORY_SIZE * sizeof(history_entry_t)];
+
+    // Chỉ giữ khóa lúc đóng gói, không giữ trong lúc ghi flash
+    user_func_lock();
+    int flushed = pending;
+    size_t len = flushed ? pack(blob, sizeof(blob)) : 0;
+    user_func_unlock();
+    if (flushed == 0) return;
+
+    esp_err_t err = nvs_open(HISTORY_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, "ring", blob, len);
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ALOGE(TAG, "Error saving history");
+        return;
+    }
+    user_func_lock();
+    pending -= flushed; // các thay đổi đến trong lúc ghi chờ lần sau
+    user_func_unlock();
+}
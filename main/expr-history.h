@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+
+#define HISTORY_NAMESPACE       "history"   // namespace NVS riêng cho lịch sử
+#define HISTORY_SIZE            8           // số biểu thức được giữ lại
+#define HISTORY_FLUSH_EVERY     4           // ghi NVS sau bấy nhiêu mục mới...
+#define HISTORY_FLUSH_IDLE_MS   30000       // ...hoặc sau bấy nhiêu ms không có mục mới
+
+typedef struct {
+    char expr[80];
+    char result[40];
+    char error[40];         // sai số tích phân "R:...", rỗng với biểu thức thường
+} history_entry_t;
+
+void history_init(void);  // nạp vòng lịch sử từ NVS
+
+void history_add(const char* expr, const char* result, const char* error);  // thêm mục mới nhất
+
+int history_get(int index, history_entry_t* out);  // chép mục index (0 = mới nhất) vào out, 0 nếu không có
+
+int history_lookup(const char* expr, history_entry_t* out);  // chép kết quả đã nhớ của expr vào out, 0 nếu chưa tính
+
+void history_forget_user_funcs(void);  // bỏ kết quả nhớ của các biểu thức gọi f/g/h; history_init đăng ký với user_func_on_define
+
+void history_clear(void);  // bỏ mọi mục, lần ghi NVS tới lưu vòng rỗng
+
+void history_tick(uint32_t now_ms);  // gọi định kỳ: ghi gộp xuống NVS khi đến hạn
+
+void history_flush(void);  // ghi ngay nếu có thay đổi (trước khi ngủ / tắt máy)
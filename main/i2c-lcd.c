@@ -1,15 +1,76 @@
 #include "i2c-lcd.h"
 #include <stdio.h>
 #include <unistd.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "async-log.h"
 
 #define SLAVE_ADDRESS_LCD 0x4E>>1 // I2C address of LCD (shifted right by 1)
 #define I2C_SCL_PIN 19    // SCL pin (modify as needed)
 #define I2C_SDA_PIN 18    // SDA pin (modify as needed)
 #define I2C_DELAY_US 5    // Delay for 100 kHz I2C clock (5us half-cycle)
+#define LCD_POWER_ON_US 50000 // >40ms after Vcc reaches 2.7V, with margin
 
 static const char *TAG = "LCD";
 static int err;
 
+#if !defined(ESP_PLATFORM)
+#include "lcd-emu.h"
+
+// Host build: frames go to the PCF8574 + HD44780 emulator in host/lcd-emu.c,
+// which counts bytes, START/STOP pairs and modeled bus time
+static void i2c_init_pins(void) {
+    // The bench resets the emulator itself: that is the LCD power-on instant
+}
+
+static int i2c_bus_write(uint8_t *data, size_t len) {
+    return lcd_emu_write(data, len);
+}
+
+static int i2c_bus_read(uint8_t *data) {
+    return lcd_emu_read(data);
+}
+
+#elif defined(CONFIG_CALC_LCD_I2C_HW)
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+
+#define I2C_PORT       I2C_NUM_0
+#define I2C_TIMEOUT_MS 10
+
+// Hardware I2C: the controller clocks the bytes out and the driver completes
+// the transaction from its ISR, so the calling task sleeps instead of spinning.
+static void i2c_init_pins(void) {
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_SDA_PIN,
+        .scl_io_num = I2C_SCL_PIN,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = CONFIG_CALC_LCD_I2C_FREQ_HZ,
+    };
+    i2c_param_config(I2C_PORT, &conf);
+    if (i2c_driver_install(I2C_PORT, I2C_MODE_MASTER, 0, 0, 0) != ESP_OK) {
+        ALOGE(TAG, "Error installing I2C driver");
+    }
+}
+
+static int i2c_bus_write(uint8_t *data, size_t len) {
+    esp_err_t ret = i2c_master_write_to_device(I2C_PORT, SLAVE_ADDRESS_LCD, data, len,
+                                               pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    return ret == ESP_OK ? 0 : -1;
+}
+
+static int i2c_bus_read(uint8_t *data) {
+    esp_err_t ret = i2c_master_read_from_device(I2C_PORT, SLAVE_ADDRESS_LCD, data, 1,
+                                                pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    return ret == ESP_OK ? 0 : -1;
+}
+
+#else // CONFIG_CALC_LCD_I2C_BITBANG
+
+#include "esp_rom_sys.h"
+
 // GPIO register definitions for ESP32
 #define GPIO_OUT_REG    (0x3FF44004 + ((I2C_SDA_PIN >= 32) ? 4 : 0)) // GPIO_OUT or GPIO_OUT1
 #define GPIO_IN_REG     (0x3FF4403C + ((I2C_SDA_PIN >= 32) ? 4 : 0)) // GPIO_IN or GPIO_IN1
@@ -27,8 +88,11 @@ static int err;
 #define REG_CLEAR_BIT(reg, bit) REG_WRITE(reg, REG_READ(reg) & ~(bit))
 
 // Software I2C functions
+// esp_rom_delay_us counts CPU cycles against the current clock, which the
+// power-management framework updates on every switch. Frames are drawn under
+// the display task's CPU_FREQ_MAX lock, so the clock cannot change mid-byte.
 static void i2c_delay(void) {
-    usleep(I2C_DELAY_US);
+    esp_rom_delay_us(I2C_DELAY_US);
 }
 
 static void i2c_sda_high(void) {
@@ -117,7 +181,7 @@ static int i2c_write_byte(uint8_t byte) {
     return i2c_read_bit() == 0 ? 0 : -1; // 0 for success, -1 for failure
 }
 
-static int i2c_master_write(uint8_t *data, size_t len) {
+static int i2c_bus_write(uint8_t *data, size_t len) {
     i2c_start();
     // Write slave address (write mode)
     if (i2c_write_byte((SLAVE_ADDRESS_LCD << 1) | 0) != 0) {
@@ -135,35 +199,161 @@ static int i2c_master_write(uint8_t *data, size_t len) {
     return 0; // Success
 }
 
-void lcd_send_cmd(char cmd) {
+static int i2c_bus_read(uint8_t *data) {
+    i2c_start();
+    // Write slave address (read mode)
+    if (i2c_write_byte((SLAVE_ADDRESS_LCD << 1) | 1) != 0) {
+        i2c_stop();
+        return -1; // Failure
+    }
+    uint8_t byte = 0;
+    for (int i = 0; i < 8; i++) {
+        byte = (byte << 1) | i2c_read_bit();
+    }
+    i2c_write_bit(1); // NACK: single byte read
+    i2c_stop();
+    *data = byte;
+    return 0; // Success
+}
+
+#endif // ESP_PLATFORM / CONFIG_CALC_LCD_I2C_HW
+
+// PCF8574 bit layout: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4-P7 = D4-D7
+#define LCD_RS_CMD  0x08 // rs=0, backlight on
+#define LCD_RS_DATA 0x09 // rs=1, backlight on
+#define LCD_EN      0x04
+#define LCD_READ    0xFA // rw=1, rs=0, D4-D7 released high so the LCD can drive them
+
+// Busy flag polling is given up for good if the module cannot be read back
+// (RW tied to GND on some backpacks, or the read is not acknowledged)
+static int busy_flag_ok = 1;
+
+#define LCD_BATCH_MAX 128 // 32 characters or commands per transaction
+
+// Batched transport: frames accumulate here and go out in one transaction
+static uint8_t batch_buf[LCD_BATCH_MAX];
+static size_t batch_len;
+static int batch_active;
+static lcd_xfer_stats_t batch_stats;
+
+// Split one byte into the 4 PCF8574 frames that strobe both nibbles
+static void lcd_pack(char value, uint8_t rs, uint8_t *data_t) {
     char data_u, data_l;
+    data_u = (value & 0xf0);
+    data_l = ((value << 4) & 0xf0);
+    data_t[0] = data_u | rs | LCD_EN; // en=1
+    data_t[1] = data_u | rs;          // en=0
+    data_t[2] = data_l | rs | LCD_EN; // en=1
+    data_t[3] = data_l | rs;          // en=0
+}
+
+static void batch_send(void) {
+    if (batch_len == 0) return;
+    int64_t start = esp_timer_get_time();
+    err = i2c_bus_write(batch_buf, batch_len);
+    batch_stats.bus_us += esp_timer_get_time() - start;
+    batch_stats.bytes += batch_len + 1; // payload + address byte
+    batch_stats.transactions++;
+    batch_len = 0;
+    if (err != 0) ALOGE(TAG, "Error in sending batch");
+}
+
+static void lcd_write(char value, uint8_t rs) {
+    if (batch_active) {
+        if (batch_len + 4 > LCD_BATCH_MAX) batch_send();
+        lcd_pack(value, rs, &batch_buf[batch_len]);
+        batch_len += 4;
+        return;
+    }
     uint8_t data_t[4];
-    data_u = (cmd & 0xf0);
-    data_l = ((cmd << 4) & 0xf0);
-    data_t[0] = data_u | 0x0C; // en=1, rs=0
-    data_t[1] = data_u | 0x08; // en=0, rs=0
-    data_t[2] = data_l | 0x0C; // en=1, rs=0
-    data_t[3] = data_l | 0x08; // en=0, rs=0
-    err = i2c_master_write(data_t, 4);
-    if (err != 0) printf("%s: Error in sending command\n", TAG);
+    lcd_pack(value, rs, data_t);
+    err = i2c_bus_write(data_t, 4);
+    if (err != 0) ALOGE(TAG, "Error in sending %s", rs == LCD_RS_CMD ? "command" : "data");
 }
 
-void lcd_send_data(char data) {
-    char data_u, data_l;
+// Read the busy flag: strobe EN for the high nibble (BF is D7) while sampling
+// the PCF8574 pins, then clock out the low nibble and return RW to write
+static int lcd_read_busy(int *busy) {
+    uint8_t strobe_high[2] = {LCD_READ, LCD_READ | LCD_EN};
+    uint8_t strobe_low[4] = {LCD_READ, LCD_READ | LCD_EN, LCD_READ, LCD_RS_CMD};
+    uint8_t pins;
+    if (i2c_bus_write(strobe_high, 2) != 0) return -1;
+    if (i2c_bus_read(&pins) != 0) return -1;
+    if (i2c_bus_write(strobe_low, 4) != 0) return -1;
+    *busy = (pins & 0x80) != 0;
+    return 0;
+}
+
+// Wait until the controller accepts the next instruction. Polls the busy flag
+// and falls back to the fixed datasheet delay if it cannot be read.
+// Returns how long the wait took in microseconds.
+static int64_t lcd_wait_ready(int fallback_us) {
+    int64_t start = esp_timer_get_time();
+    int64_t elapsed = 0;
+    while (busy_flag_ok) {
+        int busy;
+        if (lcd_read_busy(&busy) != 0) {
+            ALOGW(TAG, "Busy flag not readable, using fixed delays");
+            busy_flag_ok = 0;
+            break;
+        }
+        elapsed = esp_timer_get_time() - start;
+        if (!busy) return elapsed;
+        if (elapsed >= fallback_us) {
+            // Still busy after the worst case, so the flag is not wired
+            ALOGW(TAG, "Busy flag stuck, using fixed delays");
+            busy_flag_ok = 0;
+            return elapsed;
+        }
+    }
+    if (elapsed < fallback_us) usleep(fallback_us - elapsed);
+    return esp_timer_get_time() - start;
+}
+
+// Send a slow command on its own and wait for it, logging the achieved latency
+static void lcd_send_cmd_wait(char cmd, int fallback_us) {
+    lcd_send_cmd(cmd);
+    int64_t waited = lcd_wait_ready(fallback_us);
+    ALOGD(TAG, "cmd 0x%02X ready after %lld us (fixed delay %d us)",
+          (uint8_t)cmd, (long long)waited, fallback_us);
+}
+
+void lcd_batch_begin(void) {
+    batch_len = 0;
+    batch_stats = (lcd_xfer_stats_t){0};
+    batch_active = 1;
+}
+
+void lcd_batch_end(lcd_xfer_stats_t *stats) {
+    batch_send();
+    batch_active = 0;
+    if (stats) *stats = batch_stats;
+}
+
+// Only the high nibble of cmd, for the switch to 4-bit mode while the
+// controller still latches one 8-bit instruction per strobe
+static void lcd_send_nibble(char cmd) {
     uint8_t data_t[4];
-    data_u = (data & 0xf0);
-    data_l = ((data << 4) & 0xf0);
-    data_t[0] = data_u | 0x0D; // en=1, rs=1
-    data_t[1] = data_u | 0x09; // en=0, rs=1
-    data_t[2] = data_l | 0x0D; // en=1, rs=1
-    data_t[3] = data_l | 0x09; // en=0, rs=1
-    err = i2c_master_write(data_t, 4);
-    if (err != 0) printf("%s: Error in sending data\n", TAG);
+    lcd_pack(cmd, LCD_RS_CMD, data_t);
+    err = i2c_bus_write(data_t, 2);
+    if (err != 0) ALOGE(TAG, "Error in sending command");
+}
+
+void lcd_send_cmd(char cmd) {
+    lcd_write(cmd, LCD_RS_CMD);
+}
+
+void lcd_send_data(char data) {
+    lcd_write(data, LCD_RS_DATA);
 }
 
 void lcd_clear(void) {
-    lcd_send_cmd(0x01);
-    usleep(5000);
+    // Clear takes 1.52 ms, so it never shares a transaction with later bytes
+    int was_active = batch_active;
+    batch_send();
+    batch_active = 0;
+    lcd_send_cmd_wait(0x01, 5000);
+    batch_active = was_active;
 }
 
 void lcd_put_cur(int row, int col) {
@@ -178,29 +368,41 @@ void lcd_put_cur(int row, int col) {
     lcd_send_cmd(col);
 }
 
+void lcd_set_cgram_addr(int addr) {
+    lcd_send_cmd(0x40 | (addr & 0x3F)); // glyph n occupies addresses n*8 .. n*8+7
+}
+
 void lcd_init(void) {
     i2c_init_pins(); // Initialize GPIO pins for I2C
-    usleep(50000);   // Wait for >40ms
+    // The LCD has been powered at least as long as the app has been running,
+    // so only the rest of the >40ms power-on delay is left to wait out
+    int64_t powered_us = esp_timer_get_time();
+    if (powered_us < LCD_POWER_ON_US) usleep(LCD_POWER_ON_US - powered_us);
     lcd_send_cmd(0x30);
     usleep(5000);    // Wait for >4.1ms
     lcd_send_cmd(0x30);
     usleep(200);     // Wait for >100us
     lcd_send_cmd(0x30);
-    usleep(10000);
-    lcd_send_cmd(0x20); // 4-bit mode
-    usleep(10000);
-    lcd_send_cmd(0x28); // Function set: 4-bit, 2 lines, 5x8 chars
-    usleep(1000);
-    lcd_send_cmd(0x08); // Display off
-    usleep(1000);
-    lcd_send_cmd(0x01); // Clear display
-    usleep(2000);
-    lcd_send_cmd(0x06); // Entry mode: increment cursor, no shift
-    usleep(1000);
-    lcd_send_cmd(0x0C); // Display on, cursor off, blink off
-    usleep(1000);
+    usleep(200);     // Executes in 37us like any function set
+    lcd_send_nibble(0x20); // 4-bit mode, a single strobe so nibble pairs stay aligned
+    // The busy flag is readable from here on; the delays become upper bounds
+    lcd_wait_ready(10000);
+    lcd_send_cmd_wait(0x28, 1000); // Function set: 4-bit, 2 lines, 5x8 chars
+    lcd_send_cmd_wait(0x08, 1000); // Display off
+    lcd_send_cmd_wait(0x01, 2000); // Clear display
+    lcd_send_cmd_wait(0x06, 1000); // Entry mode: increment cursor, no shift
+    lcd_send_cmd_wait(0x0C, 1000); // Display on, cursor off, blink off
+}
+
+// The LCD and its PCF8574 backpack are powered independently of the ESP32, so
+// across deep sleep they keep the 4-bit mode, display contents and latch state
+void lcd_resume(void) {
+    i2c_init_pins();
 }
 
 void lcd_send_string(char *str) {
+    int own_batch = !batch_active;
+    if (own_batch) lcd_batch_begin();
     while (*str) lcd_send_data(*str++);
+    if (own_batch) lcd_batch_end(NULL);
 }
\ No newline at end of file
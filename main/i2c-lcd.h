@@ -1,7 +1,18 @@
+#pragma once
 
 
+#include <stdint.h>
+
+typedef struct {
+    int bytes;          // bytes on the wire, including address bytes
+    int transactions;   // START ... STOP sequences
+    int64_t bus_us;     // time spent in the I2C transport
+} lcd_xfer_stats_t;
+
 void lcd_init (void);   // initialize lcd
 
+void lcd_resume (void);   // after deep sleep: set up the I2C transport only, the HD44780 kept its state
+
 void lcd_send_cmd (char cmd);  // send command to the lcd
 
 void lcd_send_data (char data);  // send data to the lcd
@@ -11,3 +22,9 @@ void lcd_send_string (char *str);  // send string to the lcd
 void lcd_put_cur(int row, int col);  // put cursor at the entered position row (0 or 1), col (0-15);
 
 void lcd_clear (void);
+
+void lcd_set_cgram_addr(int addr);  // set CGRAM address (0-63) before uploading custom glyph rows
+
+void lcd_batch_begin(void);  // following cmd/data/put_cur calls are queued instead of sent
+
+void lcd_batch_end(lcd_xfer_stats_t *stats);  // send the queue in one transaction, stats may be NULL
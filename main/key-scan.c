@@ -0,0 +1,256 @@
+#include "key-scan.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_rom_sys.h"
+#include "driver/rtc_io.h"
+#include "sdkconfig.h"
+#include "async-log.h"
+#include "trace.h"
+
+static const char *TAG = "KEYPAD";
+
+// GPIO pins cho bàn phím
+#define ROW1    13
+#define ROW2    12
+#define ROW3    14
+#define ROW4    27
+#define COL1    26
+#define COL2    25
+#define COL3    33
+#define COL4    32
+#define KEY_WAKE_COL    COL4    // ext1 trên ESP32 chỉ đánh thức khi tất cả chân đều thấp nên chỉ dùng một cột
+
+#define KEY_SCAN_PERIOD_US  4000    // chu kỳ quét khi có phím đang nhấn
+#define KEY_DEBOUNCE_SCANS  2       // số lần đọc liên tiếp giống nhau để đổi trạng thái
+#define KEY_IDLE_SCANS      8       // số lần quét không có phím trước khi về trạng thái chờ
+#define KEY_LONG_US         800000  // giữ lâu hơn thì gửi KEY_EVENT_LONG
+
+// Trạng thái lọc dội của một phím
+typedef struct {
+    uint8_t down;               // trạng thái đã lọc dội (1 = đang nhấn)
+    uint8_t count;              // số lần đọc liên tiếp khác trạng thái
+    uint8_t long_sent;
+    int64_t edge_us;            // lần đầu đọc thấy trạng thái mới
+    int64_t next_repeat_us;
+} key_state_t;
+
+static const uint8_t row_pins[4] = {ROW1, ROW2, ROW3, ROW4};
+static const uint8_t col_pins[4] = {COL1, COL2, COL3, COL4};
+
+static const char (*key_map)[4];
+static key_state_t keys[4][4];
+static volatile uint16_t repeat_mask;   // bit row*4+col: phím tự lặp
+static int idle_scans;
+static unsigned dropped;
+
+static QueueHandle_t event_queue;
+static TaskHandle_t wake_task;
+static esp_timer_handle_t scan_timer;
+
+// Ngắt cột: tắt ngắt các cột trong lúc quét rồi đánh thức task khởi động timer
+static void IRAM_ATTR key_isr(void* arg) {
+    BaseType_t woken = pdFALSE;
+    for (int col = 0; col < 4; col++) {
+        gpio_intr_disable(col_pins[col]);
+    }
+    vTaskNotifyGiveFromISR(wake_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Trạng thái chờ: kéo tất cả hàng xuống thấp để bất kỳ phím nào cũng kéo cột
+// xuống và gây ngắt
+static void key_idle(void) {
+    for (int row = 0; row < 4; row++) {
+        gpio_set_level(row_pins[row], 0);
+    }
+    for (int col = 0; col < 4; col++) {
+        gpio_intr_enable(col_pins[col]);
+    }
+}
+
+static void post_event(key_event_type_t type, char key, int64_t time_us) {
+    key_event_t event = {type, key, time_us};
+    if (xQueueSend(event_queue, &event, 0) != pdTRUE) {
+        dropped++;
+    }
+}
+
+// Cập nhật bộ đếm lọc dội và sinh sự kiện cho một phím
+static void update_key(int row, int col, int raw, int64_t now) {
+    key_state_t* k = &keys[row][col];
+    char key = key_map[row][col];
+
+    if (raw != k->down) {
+        if (k->count == 0) k->edge_us = now;
+        if (++k->count >= KEY_DEBOUNCE_SCANS) {
+            k->down = raw;
+            k->count = 0;
+            if (raw) {
+                k->long_sent = 0;
+                k->next_repeat_us = k->edge_us + CONFIG_CALC_KEY_REPEAT_DELAY_MS * 1000LL;
+                post_event(KEY_EVENT_PRESS, key, k->edge_us);
+            } else {
+                post_event(KEY_EVENT_RELEASE, key, k->edge_us);
+            }
+        }
+    } else {
+        k->count = 0;
+    }
+
+    if (!k->down) return;
+    if (repeat_mask & (1 << (row * 4 + col))) {
+        if (now >= k->next_repeat_us) {
+            post_event(KEY_EVENT_REPEAT, key, now);
+            k->next_repeat_us = now + CONFIG_CALC_KEY_REPEAT_RATE_MS * 1000LL;
+        }
+    } else if (!k->long_sent && now - k->edge_us >= KEY_LONG_US) {
+        post_event(KEY_EVENT_LONG, key, now);
+        k->long_sent = 1;
+    }
+}
+
+// Timer quét: đọc cả ma trận mỗi chu kỳ nên hai phím nhấn cùng lúc đều được
+// ghi nhận; khi không còn phím nào thì dừng timer và quay về chờ ngắt
+static void scan_timer_cb(void* arg) {
+    TRACE_BEGIN(start);
+    int64_t now = esp_timer_get_time();
+    int busy = 0;
+    for (int row = 0; row < 4; row++) {
+        gpio_set_level(row_pins[row], 0);
+        for (int col = 0; col < 4; col++) {
+            update_key(row, col, gpio_get_level(col_pins[col]) == 0, now);
+            busy |= keys[row][col].down || keys[row][col].count;
+        }
+        gpio_set_level(row_pins[row], 1);
+    }
+
+    if (busy) {
+        idle_scans = 0;
+    } else if (++idle_scans >= KEY_IDLE_SCANS) {
+        esp_timer_stop(scan_timer);
+        key_idle();
+    }
+    TRACE_END(TRACE_KEY_SCAN, start);
+}
+
+// Phím đang được giữ lúc khởi động (thường là phím vừa đánh thức từ deep sleep)
+// coi như đã nhấn từ trước: không sinh KEY_EVENT_PRESS, chỉ có RELEASE khi nhả
+static void key_seed(void) {
+    for (int row = 0; row < 4; row++) {
+        gpio_set_level(row_pins[row], 1);
+    }
+    for (int row = 0; row < 4; row++) {
+        gpio_set_level(row_pins[row], 0);
+        esp_rom_delay_us(10);
+        for (int col = 0; col < 4; col++) {
+            keys[row][col].down = gpio_get_level(col_pins[col]) == 0;
+            keys[row][col].long_sent = 1;
+        }
+        gpio_set_level(row_pins[row], 1);
+    }
+}
+
+// Timer không khởi động được từ ISR, task nhỏ này làm việc đó
+static void key_wake_task(void* arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (int row = 0; row < 4; row++) {
+            gpio_set_level(row_pins[row], 1);
+        }
+        idle_scans = 0;
+        esp_timer_start_periodic(scan_timer, KEY_SCAN_PERIOD_US);
+    }
+}
+
+void key_scan_start(const char map[4][4]) {
+    key_map = map;
+    event_queue = xQueueCreate(KEY_QUEUE_LEN, sizeof(key_event_t));
+
+    // Các hàng còn bị giữ mức nếu vừa thức dậy từ deep sleep
+    for (int row = 0; row < 4; row++) {
+        gpio_hold_dis(row_pins[row]);
+    }
+
+    gpio_config_t row_config = {
+        .pin_bit_mask = (1ULL << ROW1) | (1ULL << ROW2) | (1ULL << ROW3) | (1ULL << ROW4),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    gpio_config(&row_config);
+
+    gpio_config_t col_config = {
+        .pin_bit_mask = (1ULL << COL1) | (1ULL << COL2) | (1ULL << COL3) | (1ULL << COL4),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE
+    };
+    gpio_config(&col_config);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = scan_timer_cb,
+        .name = "key_scan"
+    };
+    if (esp_timer_create(&timer_args, &scan_timer) != ESP_OK) {
+        ALOGE(TAG, "Cannot create scan timer");
+        return;
+    }
+    xTaskCreate(key_wake_task, "key_wake", 2048, NULL, 6, &wake_task);
+
+    gpio_install_isr_service(0);
+    for (int col = 0; col < 4; col++) {
+        gpio_intr_disable(col_pins[col]);
+        gpio_isr_handler_add(col_pins[col], key_isr, NULL);
+#ifdef CONFIG_CALC_LIGHT_SLEEP
+        // Light sleep chỉ đánh thức được theo mức: ngắt chuyển sang mức thấp,
+        // ISR vẫn tự tắt ngắt nên không bị gọi lặp khi giữ phím
+        gpio_wakeup_enable(col_pins[col], GPIO_INTR_LOW_LEVEL);
+#endif
+    }
+#ifdef CONFIG_CALC_LIGHT_SLEEP
+    esp_sleep_enable_gpio_wakeup();
+#endif
+
+    key_seed();
+    key_idle();
+}
+
+void key_scan_deep_sleep(void) {
+    esp_timer_stop(scan_timer);
+    // Trong deep sleep chỉ miền RTC còn điện: các hàng được giữ mức thấp, cột
+    // đánh thức dùng điện trở kéo lên của RTC IO nên phải giữ RTC_PERIPH bật
+    for (int row = 0; row < 4; row++) {
+        gpio_set_level(row_pins[row], 0);
+        gpio_hold_en(row_pins[row]);
+    }
+    gpio_deep_sleep_hold_en();
+    rtc_gpio_pullup_en(KEY_WAKE_COL);
+    rtc_gpio_pulldown_dis(KEY_WAKE_COL);
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    esp_sleep_enable_ext1_wakeup(1ULL << KEY_WAKE_COL, ESP_EXT1_WAKEUP_ALL_LOW);
+}
+
+int key_scan_get(key_event_t* event, uint32_t timeout_ms) {
+    return xQueueReceive(event_queue, event, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+void key_scan_set_repeat(const char* keys_to_repeat) {
+    uint16_t mask = 0;
+    for (const char* c = keys_to_repeat; *c; c++) {
+        for (int i = 0; i < 16; i++) {
+            if (key_map[i / 4][i % 4] == *c) mask |= 1 << i;
+        }
+    }
+    repeat_mask = mask;
+}
+
+unsigned key_scan_dropped(void) {
+    return dropped;
+}
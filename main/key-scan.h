@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#define KEY_QUEUE_LEN   16      // sự kiện chờ xử lý, giữ phím gõ trong lúc đang tính
+
+typedef enum {
+    KEY_EVENT_PRESS,            // phím vừa nhấn (đã lọc dội)
+    KEY_EVENT_RELEASE,          // phím vừa nhả
+    KEY_EVENT_LONG,             // giữ lâu (phím không tự lặp)
+    KEY_EVENT_REPEAT,           // tự lặp khi giữ (phím trong danh sách lặp)
+} key_event_type_t;
+
+typedef struct {
+    key_event_type_t type;
+    char key;
+    int64_t time_us;            // lúc tiếp điểm bắt đầu đóng/mở hoặc lúc lặp
+} key_event_t;
+
+void key_scan_start(const char map[4][4]);  // cấu hình GPIO, ngắt cột và timer quét, đưa bàn phím về trạng thái chờ
+
+void key_scan_deep_sleep(void);  // giữ các hàng ở mức thấp và đặt cột 4 (+ - * /) làm nguồn đánh thức ext1
+
+int key_scan_get(key_event_t* event, uint32_t timeout_ms);  // chờ một sự kiện phím, trả 0 nếu hết thời gian
+
+void key_scan_set_repeat(const char* keys);  // các phím tự lặp khi giữ, "" để tắt
+
+unsigned key_scan_dropped(void);  // số sự kiện bị bỏ vì hàng đợi đầy
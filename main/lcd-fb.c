@@ -0,0 +1,106 @@
+#include "lcd-fb.h"
+#include <string.h>
+#include "esp_attr.h"
+
+// Runs separated by this many unchanged cells or fewer are sent as one run:
+// rewriting one cell costs the same 4 bytes as a cursor command.
+#define FB_MAX_GAP 1
+
+#define LCD_SHIFT_LEFT  0x18 // display shift, content moves left (window moves right)
+#define LCD_SHIFT_RIGHT 0x1C // display shift, content moves right
+
+#define FB_MODEL_MAGIC 0x46424D31 // "FBM1"
+
+// DDRAM is circular per line and the display shift selects which 16 of the 40
+// addresses are visible, so the model is the whole DDRAM plus the shift.
+// It lives in RTC slow memory: the HD44780 stays powered through deep sleep,
+// so after a wake the model still matches what the display holds.
+static RTC_DATA_ATTR char ddram[FB_ROWS][FB_DDRAM_COLS];
+static RTC_DATA_ATTR int ddram_shift; // address shown in the leftmost column
+static RTC_DATA_ATTR unsigned model_magic; // FB_MODEL_MAGIC once fb_init has run
+
+_Static_assert(FB_WIDE <= FB_DDRAM_COLS, "screen must fit in DDRAM");
+
+void fb_init(void) {
+    memset(ddram, ' ', sizeof(ddram));
+    ddram_shift = 0;
+    model_magic = FB_MODEL_MAGIC;
+}
+
+int fb_resume(void) {
+    return model_magic == FB_MODEL_MAGIC;
+}
+
+void fb_clear(fb_screen_t *screen) {
+    memset(screen->cells, ' ', sizeof(screen->cells));
+    screen->scroll = 0;
+}
+
+void fb_set_scroll(fb_screen_t *screen, int scroll) {
+    screen->scroll = scroll;
+}
+
+void fb_put_char(fb_screen_t *screen, int row, int col, char c) {
+    if (row < 0 || row >= FB_ROWS || col < -FB_MARGIN || col >= FB_COLS + FB_MARGIN) return;
+    screen->cells[row][col + FB_MARGIN] = c;
+}
+
+void fb_put_string(fb_screen_t *screen, int row, int col, const char *str) {
+    while (*str && col < FB_COLS + FB_MARGIN) {
+        fb_put_char(screen, row, col++, *str++);
+    }
+}
+
+// DDRAM address holding screen cell k when the display is shifted by shift
+static int cell_addr(int shift, int k) {
+    return (shift - FB_MARGIN + k + FB_DDRAM_COLS) % FB_DDRAM_COLS;
+}
+
+void fb_flush(const fb_screen_t *screen, lcd_xfer_stats_t *stats) {
+    int shift = ((screen->scroll % FB_DDRAM_COLS) + FB_DDRAM_COLS) % FB_DDRAM_COLS;
+
+    lcd_batch_begin();
+    // Fill DDRAM first: cells about to scroll into view are written while
+    // still off screen, then the shift reveals them
+    for (int row = 0; row < FB_ROWS; row++) {
+        const char *want = screen->cells[row];
+        int cursor = -1; // DDRAM address unknown at the start of each row
+        int k = 0;
+        while (k < FB_WIDE) {
+            int addr = cell_addr(shift, k);
+            if (ddram[row][addr] == want[k]) {
+                k++;
+                continue;
+            }
+
+            // Extend the run over short stretches of unchanged cells, but not
+            // across the end of the line where the address counter jumps rows
+            int end = k + 1;
+            int last_dirty = k;
+            while (end < FB_WIDE && end - last_dirty <= FB_MAX_GAP + 1 && cell_addr(shift, end) != 0) {
+                if (ddram[row][cell_addr(shift, end)] != want[end]) last_dirty = end;
+                end++;
+            }
+
+            if (cursor != addr) {
+                lcd_put_cur(row, addr);
+            }
+            for (int c = k; c <= last_dirty; c++) {
+                lcd_send_data(want[c]);
+                ddram[row][cell_addr(shift, c)] = want[c];
+            }
+            cursor = cell_addr(shift, last_dirty) + 1; // the HD44780 auto-increments after each write
+            k = last_dirty + 1;
+        }
+    }
+
+    // One command byte per column, whichever way round the circle is shorter
+    int steps = (shift - ddram_shift + FB_DDRAM_COLS) % FB_DDRAM_COLS;
+    if (steps <= FB_DDRAM_COLS / 2) {
+        while (steps-- > 0) lcd_send_cmd(LCD_SHIFT_LEFT);
+    } else {
+        for (steps = FB_DDRAM_COLS - steps; steps > 0; steps--) lcd_send_cmd(LCD_SHIFT_RIGHT);
+    }
+    ddram_shift = shift;
+    lcd_batch_end(stats);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "i2c-lcd.h"
+
+#define FB_ROWS 2
+#define FB_COLS 16
+#define FB_MARGIN 4                             // off-screen columns kept loaded on each side
+#define FB_WIDE (FB_COLS + 2 * FB_MARGIN)       // columns a screen describes, must fit in DDRAM
+#define FB_DDRAM_COLS 40                        // HD44780 DDRAM characters per line
+
+// A complete frame. Screens are composed by the caller (no LCD access) and
+// handed to fb_flush, so they can be built on one task and sent on another.
+// Columns run from -FB_MARGIN to FB_COLS + FB_MARGIN - 1 relative to the
+// visible window; the margins are written to DDRAM just off screen so that
+// scrolling by a few columns only needs display shift commands.
+typedef struct {
+    char cells[FB_ROWS][FB_WIDE];
+    int scroll;                                 // virtual column shown at the left edge
+} fb_screen_t;
+
+void fb_init(void);  // DDRAM model blank and unshifted, matching a freshly cleared display
+
+int fb_resume(void);  // after deep sleep: 1 if the retained DDRAM model is valid, else call lcd_clear + fb_init
+
+void fb_clear(fb_screen_t *screen);  // blank every cell and reset scroll (nothing is sent)
+
+void fb_set_scroll(fb_screen_t *screen, int scroll);  // pan the window, e.g. to the first shown character
+
+void fb_put_char(fb_screen_t *screen, int row, int col, char c);  // write one cell, col may be in the margins
+
+void fb_put_string(fb_screen_t *screen, int row, int col, const char *str);  // write cells until '\0' or end of right margin
+
+void fb_flush(const fb_screen_t *screen, lcd_xfer_stats_t *stats);  // send changed cells and shifts in one I2C transaction, stats may be NULL
@@ -0,0 +1,148 @@
+#include "lcd-plot.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "i2c-lcd.h"
+
+// Chương trình đã biên dịch và cửa sổ hiện tại
+static bc_program_t plot_prog;
+static double plot_a = 0.0;
+static double plot_b = 1.0;
+
+// Bản sao nội dung CGRAM trên LCD để chỉ gửi phần thay đổi
+static uint8_t cgram_shadow[PLOT_CELLS][8];
+static int cgram_valid = 0;
+
+bc_status_t plot_open(const char* f_expr, double a, double b) {
+    bc_status_t status = bc_compile(f_expr, &plot_prog);
+    if (status != BC_OK) return status;
+
+    if (a == b) b = a + 1.0;
+    plot_a = (a < b) ? a : b;
+    plot_b = (a < b) ? b : a;
+    return BC_OK;
+}
+
+void plot_pan(int direction) {
+    double shift = (plot_b - plot_a) / 4.0 * direction;
+    plot_a += shift;
+    plot_b += shift;
+}
+
+void plot_zoom(int direction) {
+    double center = (plot_a + plot_b) / 2.0;
+    double half = (plot_b - plot_a) / 2.0;
+    half = (direction > 0) ? half / 2.0 : half * 2.0;
+    plot_a = center - half;
+    plot_b = center + half;
+}
+
+// Vẽ các mẫu vào 8 ô 5x8, nối các điểm liền kề bằng đoạn thẳng đứng. Hàng -1
+// là mẫu không vẽ được, ngắt đường nối.
+static void rasterize(const int* rows, uint8_t glyphs[PLOT_CELLS][8]) {
+    memset(glyphs, 0, PLOT_CELLS * 8);
+    int prev = -1;
+    for (int px = 0; px < PLOT_WIDTH; px++) {
+        if (rows[px] < 0) {
+            prev = -1;
+            continue;
+        }
+        int top = rows[px], bottom = rows[px];
+        if (prev >= 0) {
+            // Nửa đoạn nối về phía mẫu trước
+            int mid = (prev + rows[px]) / 2;
+            if (mid < top) top = mid;
+            if (mid > bottom) bottom = mid;
+        }
+        uint8_t bit = 1 << (4 - px % 5);
+        for (int r = top; r <= bottom; r++) {
+            glyphs[px / 5][r] |= bit;
+        }
+        prev = rows[px];
+    }
+}
+
+// Gửi các byte CGRAM khác bản sao; các byte liền nhau dùng chung một lệnh đặt địa chỉ
+static void upload_glyphs(uint8_t glyphs[PLOT_CELLS][8]) {
+    int next_addr = -1;
+    lcd_batch_begin();
+    for (int cell = 0; cell < PLOT_CELLS; cell++) {
+        for (int r = 0; r < 8; r++) {
+            if (cgram_valid && cgram_shadow[cell][r] == glyphs[cell][r]) continue;
+            int addr = cell * 8 + r;
+            if (addr != next_addr) lcd_set_cgram_addr(addr);
+            lcd_send_data(glyphs[cell][r]);
+            cgram_shadow[cell][r] = glyphs[cell][r];
+            next_addr = addr + 1;
+        }
+    }
+    lcd_batch_end(NULL);
+    cgram_valid = 1;
+}
+
+void plot_get_view(plot_view_t* view) {
+    view->prog = plot_prog;
+    view->a = plot_a;
+    view->b = plot_b;
+}
+
+// Chạy trên task hiển thị: chỉ dùng bản sao trong view, vì bàn phím có thể
+// đang dịch cửa sổ hoặc mở đồ thị mới cùng lúc
+void plot_render(fb_screen_t* screen, const plot_view_t* view) {
+    double xs[PLOT_WIDTH], ys[PLOT_WIDTH];
+    bc_status_t status[PLOT_WIDTH];
+    int rows[PLOT_WIDTH];
+    double a = view->a, b = view->b;
+
+    // Lấy mẫu cả cửa sổ trong một lần chạy theo lô
+    double step = (b - a) / (PLOT_WIDTH - 1);
+    for (int px = 0; px < PLOT_WIDTH; px++) {
+        xs[px] = a + px * step;
+    }
+    bc_run_batch(&view->prog, xs, ys, status, PLOT_WIDTH);
+
+    // Tự co giãn trục y theo các mẫu hợp lệ. Mẫu tràn số (2^x, x^50 trên cửa sổ
+    // rộng) không vẽ được nên bị bỏ như mẫu lỗi.
+    int valid = 0;
+    double y_min = 0.0, y_max = 0.0;
+    for (int px = 0; px < PLOT_WIDTH; px++) {
+        rows[px] = -1;
+        if (status[px] != BC_OK || !isfinite(ys[px])) continue;
+        rows[px] = 0;
+        if (!valid || ys[px] < y_min) y_min = ys[px];
+        if (!valid || ys[px] > y_max) y_max = ys[px];
+        valid = 1;
+    }
+    // Chia đôi trước khi trừ để y_max - y_min không tràn khi hai đầu quá xa nhau
+    double half_span = y_max / 2 - y_min / 2;
+    for (int px = 0; px < PLOT_WIDTH; px++) {
+        if (rows[px] < 0) continue;
+        int row = PLOT_HEIGHT / 2;
+        if (half_span > 0) {
+            row = (PLOT_HEIGHT - 1) - (int)((ys[px] / 2 - y_min / 2) / half_span * (PLOT_HEIGHT - 1) + 0.5);
+        }
+        rows[px] = row < 0 ? 0 : (row > PLOT_HEIGHT - 1 ? PLOT_HEIGHT - 1 : row);
+    }
+
+    uint8_t glyphs[PLOT_CELLS][8];
+    rasterize(rows, glyphs);
+    upload_glyphs(glyphs);
+
+    // Dòng 1: 8 ô đồ thị + y lớn nhất
+    char line[17], label[24];
+    for (int cell = 0; cell < PLOT_CELLS; cell++) {
+        fb_put_char(screen, 0, cell, cell);
+    }
+    if (valid) snprintf(label, sizeof(label), "%.3g", y_max);
+    else strcpy(label, "No data");
+    snprintf(line, sizeof(line), "%8.8s", label);
+    fb_put_string(screen, 0, PLOT_CELLS, line);
+
+    // Dòng 2: y nhỏ nhất + khoảng x hiện tại
+    snprintf(label, sizeof(label), "%.3g", valid ? y_min : 0.0);
+    snprintf(line, sizeof(line), "%-8.8s", label);
+    fb_put_string(screen, 1, 0, line);
+    snprintf(label, sizeof(label), "%.2g:%.2g", a, b);
+    snprintf(line, sizeof(line), "%8.8s", label);
+    fb_put_string(screen, 1, 8, line);
+}
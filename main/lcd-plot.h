@@ -0,0 +1,25 @@
+#pragma once
+
+#include "calc-bytecode.h"
+#include "lcd-fb.h"
+
+#define PLOT_CELLS      8                   // số ô ký tự tự định nghĩa (CGRAM có 8 ô)
+#define PLOT_WIDTH      (PLOT_CELLS * 5)    // 40 cột điểm ảnh, mỗi cột một mẫu
+#define PLOT_HEIGHT     8                   // 8 hàng điểm ảnh
+
+bc_status_t plot_open(const char* f_expr, double a, double b);  // biên dịch f một lần và đặt cửa sổ [a,b]
+
+void plot_pan(int direction);  // dịch cửa sổ 1/4 độ rộng: -1 sang trái, +1 sang phải
+
+void plot_zoom(int direction);  // +1 phóng to, -1 thu nhỏ quanh tâm cửa sổ
+
+// Một khung đồ thị: bản sao chương trình và cửa sổ, gửi kèm yêu cầu vẽ cho task
+// hiển thị để task đó không đọc trạng thái mà bàn phím đang sửa
+typedef struct {
+    bc_program_t prog;
+    double a, b;
+} plot_view_t;
+
+void plot_get_view(plot_view_t* view);  // chương trình và cửa sổ hiện tại
+
+void plot_render(fb_screen_t* screen, const plot_view_t* view);  // lấy mẫu theo lô, gửi các byte CGRAM đã đổi và vẽ chữ vào màn hình
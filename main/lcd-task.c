@@ -0,0 +1,126 @@
+#include "lcd-task.h"
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "sdkconfig.h"
+#include "lcd-plot.h"
+#include "async-log.h"
+#include "boot-time.h"
+#include "trace.h"
+
+static const char *TAG = "DISPLAY";
+
+#define DISPLAY_FRAME_TICKS pdMS_TO_TICKS(1000 / CONFIG_CALC_DISPLAY_MAX_FPS)
+
+// Đường sâu nhất của task là vẽ đồ thị có f -> g -> h lồng nhau: display_task
+// (~0.4 KB), plot_render (~1.2 KB), ngăn xếp lô của bc_run_batch (~1.2 KB) và
+// BC_MAX_CALL_DEPTH khung bc_exec (~0.25 KB mỗi khung), tổng ~3.7 KB theo
+// -fstack-usage, chưa kể khung ngắt và cửa sổ thanh ghi Xtensa
+#define DISPLAY_STACK_SIZE      6144
+#define DISPLAY_STACK_MARGIN    1024    // cảnh báo khi phần chưa dùng tới ít hơn
+
+// Yêu cầu vẽ: nội dung chữ đã soạn sẵn, cộng chương trình và cửa sổ nếu đang vẽ đồ thị
+typedef struct {
+    fb_screen_t screen;
+    int plot;
+    plot_view_t view;       // chép cả chương trình: bàn phím có thể mở đồ thị mới trong lúc vẽ
+} display_request_t;
+
+// Hộp thư một chỗ: xQueueOverwrite thay khung đang chờ bằng khung mới nhất,
+// nên các phím bấm dồn dập chỉ tạo ra một lần vẽ
+static QueueHandle_t request_queue;
+
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+// Giữ tần số CPU cố định trong suốt một khung: vẽ đồ thị nhanh hơn và các
+// khoảng trễ của I2C bit-bang không bị đổi tần số giữa chừng
+static esp_pm_lock_handle_t frame_lock;
+#endif
+
+// Đưa LCD về trạng thái sẵn sàng. Chạy trên task hiển thị nên các khoảng chờ
+// của chuỗi khởi tạo trùng với phần khởi động còn lại của app_main.
+static void display_bring_up(int resumed) {
+    if (resumed && fb_resume()) {
+        // Thức từ deep sleep: LCD vẫn giữ nội dung và chế độ 4 bit
+        lcd_resume();
+    } else {
+        lcd_init(); // ends with a clear display, matching fb_init
+        fb_init();
+    }
+    boot_mark(BOOT_LCD);
+}
+
+static void display_task(void* arg) {
+    display_bring_up((int)(intptr_t)arg);
+
+    display_request_t request;
+    TickType_t last_frame = xTaskGetTickCount() - DISPLAY_FRAME_TICKS;
+    while (1) {
+        xQueueReceive(request_queue, &request, portMAX_DELAY);
+
+        // Giới hạn tốc độ khung hình: chờ hết khoảng cách tối thiểu rồi lấy
+        // trạng thái mới nhất đến trong lúc chờ
+        TickType_t since = xTaskGetTickCount() - last_frame;
+        if (since < DISPLAY_FRAME_TICKS) {
+            vTaskDelay(DISPLAY_FRAME_TICKS - since);
+            xQueueReceive(request_queue, &request, 0);
+        }
+        last_frame = xTaskGetTickCount();
+
+        lcd_xfer_stats_t frame;
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+        esp_pm_lock_acquire(frame_lock);
+#endif
+        int64_t frame_start = esp_timer_get_time();
+        TRACE_BEGIN(frame_cycles);
+        if (request.plot) {
+            plot_render(&request.screen, &request.view);
+        }
+        fb_flush(&request.screen, &frame);
+        TRACE_END(TRACE_LCD_FRAME, frame_cycles);
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+        esp_pm_lock_release(frame_lock);
+#endif
+        boot_mark(BOOT_FIRST_FRAME);
+        ALOGI(TAG, "LCD frame: %lld us, %d bytes, %lld us on bus",
+              (long long)(esp_timer_get_time() - frame_start), frame.bytes, (long long)frame.bus_us);
+        if (request.plot) {
+            // Mức nước cao của ngăn xếp sau khung đồ thị, tính bằng byte
+            UBaseType_t unused = uxTaskGetStackHighWaterMark(NULL);
+            if (unused < DISPLAY_STACK_MARGIN) {
+                ALOGW(TAG, "Display stack: %u of %d bytes unused", (unsigned)unused, DISPLAY_STACK_SIZE);
+            } else {
+                ALOGD(TAG, "Display stack: %u of %d bytes unused", (unsigned)unused, DISPLAY_STACK_SIZE);
+            }
+        }
+    }
+}
+
+void display_task_start(int resumed) {
+    request_queue = xQueueCreate(1, sizeof(display_request_t));
+    if (request_queue == NULL) {
+        ALOGE(TAG, "Failed to create render queue");
+        return;
+    }
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "lcd_frame", &frame_lock) != ESP_OK) {
+        ALOGE(TAG, "Failed to create PM lock");
+        return;
+    }
+#endif
+    xTaskCreate(display_task, "display", DISPLAY_STACK_SIZE, (void*)(intptr_t)resumed, 4, NULL);
+}
+
+void display_submit(const fb_screen_t* screen, int plot) {
+    if (request_queue == NULL) return;
+
+    display_request_t request;
+    request.screen = *screen;
+    request.plot = plot;
+    if (plot) {
+        plot_get_view(&request.view);
+    }
+    xQueueOverwrite(request_queue, &request);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "lcd-fb.h"
+
+void display_task_start(int resumed);  // tạo task hiển thị; task tự khởi tạo LCD (resumed: chỉ nối lại I2C sau deep sleep) trong lúc app_main làm việc khác
+
+void display_submit(const fb_screen_t* screen, int plot);  // gửi khung mới, không bao giờ chặn; khung chưa vẽ bị thay thế
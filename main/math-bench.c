@@ -0,0 +1,202 @@
+#include "math-bench.h"
+
+#if !defined(ESP_PLATFORM) || defined(CONFIG_CALC_MATH_BENCH)
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "calc-math.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+
+#define BENCH_POINTS    512     // số đầu vào lưới mỗi trường hợp, nhỏ để vừa task của server
+#define BENCH_REPEAT    1
+#define BENCH_UNIT      "cycles"
+
+// Thiết bị không có kiểu rộng hơn: chuẩn là double libm của newlib (<= 1 ULP)
+typedef double ref_t;
+#define REF(f)          f
+#define REF_PI          3.14159265358979323846
+
+static uint64_t bench_now(void) {
+    return esp_cpu_get_cycle_count();
+}
+
+static uint64_t bench_elapsed(uint64_t start) {
+    return (uint32_t)(esp_cpu_get_cycle_count() - (uint32_t)start); // quay vòng sau ~18 s ở 240 MHz
+}
+#else
+#include <time.h>
+
+#define BENCH_POINTS    4096
+#define BENCH_REPEAT    16
+#define BENCH_UNIT      "ns"
+
+typedef long double ref_t;
+#define REF(f)          f##l
+#define REF_PI          3.14159265358979323846264338327950288L
+
+static uint64_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t bench_elapsed(uint64_t start) {
+    return bench_now() - start;
+}
+#endif
+
+typedef struct {
+    const char* kernel;
+    const char* set;
+    double (*fn)(double);
+    ref_t (*ref)(double);
+    double lo, hi;              // miền của lưới, hoặc của các đầu vào edge hợp lệ
+    int log_spaced;             // lưới cách đều theo log(x)
+    const double* edge;         // danh sách đầu vào thay cho lưới
+    int edge_count;
+} bench_case_t;
+
+#define EDGE(list)  list, (int)(sizeof(list) / sizeof(list[0]))
+
+// Đưa các hàm về cùng dạng double(double)
+static double k_pow_int(double x) { return my_pow(x, 3); }
+static double k_pow_frac(double x) { return my_pow(x, 2.5); }
+static double k_factorial(double x) { return factorial((int)x); }
+
+// Giá trị chuẩn. Độ được rút gọn chính xác trước nên sin(180k) đúng bằng 0.
+static ref_t r_sin_deg(double x) {
+    ref_t d = REF(fmod)((ref_t)x, 360);
+    if (REF(fmod)(d, 180) == 0) return 0;
+    return REF(sin)(d * REF_PI / 180);
+}
+static ref_t r_sin_rad(double x) { return REF(sin)((ref_t)x); }
+static ref_t r_sqrt(double x) { return REF(sqrt)((ref_t)x); }
+static ref_t r_log(double x) { return REF(log)((ref_t)x); }
+static ref_t r_pow_int(double x) { return REF(pow)((ref_t)x, 3); }
+static ref_t r_pow_frac(double x) { return REF(pow)((ref_t)x, 2.5); }
+static ref_t r_factorial(double x) { return REF(tgamma)((ref_t)(int)x + 1); }
+
+static const double sin_deg_edge[] = {
+    0, 1e-9, 30, 45, 60, 89.999999, 90, 180, 270, 359.999999, 360, -90, -180,
+    720.5, 3600, 1e5 + 30, -1e5, 1e7,
+};
+static const double sin_rad_edge[] = {
+    0, 1e-12, 1e-6, 0.5235987755982988, 1.5707963267948966, 3.141592653589793,
+    4.71238898038469, 6.283185307179586, -1.5707963267948966, 10, 100, 1000, 1e5,
+};
+static const double sqrt_edge[] = {
+    1e-300, 1e-12, 1e-6, 0.25, 0.5, 1, 2, 3, 4, 1e6, 1e12, 1e100, 1e300,
+};
+static const double log_edge[] = {
+    1e-300, 1e-9, 1e-3, 0.5, 0.999999, 1, 1.000001, 2, 2.718281828459045, 10, 100,
+    1e3, 1e6, 1e12, 1e300,
+};
+static const double pow_int_edge[] = {
+    -10, -2, -1, -1e-3, 1e-3, 0.5, 1, 2, 10, 1e3, 1e100,
+};
+static const double pow_frac_edge[] = {
+    1e-6, 1e-3, 0.5, 0.999999, 1, 1.000001, 2, 10, 100, 1e3,
+};
+static const double factorial_edge[] = {
+    0, 1, 2, 3, 5, 10, 12, 15, 18, 20, 21, 22, 25, 30, 50, 100, 150, 170,
+};
+
+static const bench_case_t cases[] = {
+    {"sin_deg",   "dense", my_sin_deg,  r_sin_deg,   -720, 720,    0},
+    {"sin_deg",   "edge",  my_sin_deg,  r_sin_deg,   -1e300, 1e300, 0, EDGE(sin_deg_edge)},
+    {"sin_rad",   "dense", my_sin_rad,  r_sin_rad,   -12.566370614359172, 12.566370614359172, 0},
+    {"sin_rad",   "edge",  my_sin_rad,  r_sin_rad,   -1e300, 1e300, 0, EDGE(sin_rad_edge)},
+    {"sqrt",      "dense", my_sqrt,     r_sqrt,      1e-3, 1e3,    1},
+    {"sqrt",      "edge",  my_sqrt,     r_sqrt,      0, 1e300,     0, EDGE(sqrt_edge)},
+    {"log",       "dense", my_log,      r_log,       1e-3, 1e3,    1},
+    {"log",       "edge",  my_log,      r_log,       1e-300, 1e300, 0, EDGE(log_edge)},
+    {"pow_int",   "dense", k_pow_int,   r_pow_int,   -10, 10,      0},
+    {"pow_int",   "edge",  k_pow_int,   r_pow_int,   -1e300, 1e300, 0, EDGE(pow_int_edge)},
+    {"pow_frac",  "dense", k_pow_frac,  r_pow_frac,  1e-2, 1e2,    1},
+    {"pow_frac",  "edge",  k_pow_frac,  r_pow_frac,  1e-300, 1e300, 0, EDGE(pow_frac_edge)},
+    {"factorial", "edge",  k_factorial, r_factorial, 0, 170,       0, EDGE(factorial_edge)},
+};
+
+#define CASE_COUNT  (int)(sizeof(cases) / sizeof(cases[0]))
+
+static double inputs[BENCH_POINTS];
+static volatile double sink;
+
+int math_bench_count(void) {
+    return CASE_COUNT;
+}
+
+// Sai số của y tính bằng ULP của giá trị chuẩn làm tròn đúng; dưới DBL_MIN dùng
+// ULP của DBL_MIN, nên sai dấu hay phần dư khi đáp số là 0 vẫn lộ ra
+static double ulp_error(double y, ref_t ref) {
+    if (isnan(y) || isinf(y)) return (double)INFINITY;
+    double mag = fabs((double)ref);
+    if (mag < DBL_MIN) mag = DBL_MIN;
+    double ulp = nextafter(mag, (double)INFINITY) - mag;
+    return (double)(REF(fabs)((ref_t)y - ref) / ulp);
+}
+
+static int make_inputs(const bench_case_t* c) {
+    int n = 0;
+    if (c->edge) {
+        for (int i = 0; i < c->edge_count && n < BENCH_POINTS; i++) {
+            if (c->edge[i] >= c->lo && c->edge[i] <= c->hi) inputs[n++] = c->edge[i];
+        }
+        return n;
+    }
+    for (int i = 0; i < BENCH_POINTS; i++) {
+        double t = (double)i / (BENCH_POINTS - 1);
+        inputs[n++] = c->log_spaced ? c->lo * pow(c->hi / c->lo, t) : c->lo + (c->hi - c->lo) * t;
+    }
+    return n;
+}
+
+int math_bench_run(int index, math_bench_result_t* result) {
+    if (index < 0 || index >= CASE_COUNT) return -1;
+    const bench_case_t* c = &cases[index];
+    int n = make_inputs(c);
+
+    // Đo riêng thời gian của hàm trên mọi đầu vào, sau đó mới kiểm tra từng kết quả
+    double sum = 0;
+    uint64_t start = bench_now();
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+        for (int i = 0; i < n; i++) {
+            sum += c->fn(inputs[i]);
+        }
+    }
+    uint64_t elapsed = bench_elapsed(start);
+    sink = sum;
+
+    result->kernel = c->kernel;
+    result->set = c->set;
+    result->count = n;
+    result->per_call = n ? (double)elapsed / ((double)n * BENCH_REPEAT) : 0;
+    result->max_ulp = 0;
+    result->mean_ulp = 0;
+    result->max_abs = 0;
+    result->worst_input = n ? inputs[0] : 0;
+    for (int i = 0; i < n; i++) {
+        double y = c->fn(inputs[i]);
+        ref_t ref = c->ref(inputs[i]);
+        double err = ulp_error(y, ref);
+        double abs_err = (double)REF(fabs)((ref_t)y - ref);
+        if (err > result->max_ulp) {
+            result->max_ulp = err;
+            result->worst_input = inputs[i];
+        }
+        if (abs_err > result->max_abs || isnan(abs_err)) result->max_abs = abs_err;
+        result->mean_ulp += err / n;
+    }
+    return 0;
+}
+
+int math_bench_format(const math_bench_result_t* result, char* buf, size_t size) {
+    return snprintf(buf, size, "%s %s %d %.1f %s %.3g %.3g %.3g %.17g", result->kernel, result->set,
+                    result->count, result->per_call, BENCH_UNIT, result->max_ulp, result->mean_ulp,
+                    result->max_abs, result->worst_input);
+}
+
+#endif // !ESP_PLATFORM || CONFIG_CALC_MATH_BENCH
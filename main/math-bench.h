@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include "sdkconfig.h"
+
+// Đo tốc độ và độ chính xác các hàm toán tự viết (calc-math.c). Mỗi trường hợp
+// là một hàm trên một tập đầu vào (lưới "dense" hoặc danh sách "edge"), báo thời
+// gian mỗi lần gọi và sai số so với giá trị chuẩn, tính bằng ULP (đơn vị ở chữ số
+// cuối) của số double làm tròn đúng. Bản host (host/math-bench) đo bằng ns, chuẩn
+// là long double libm. Trên thiết bị, khi bật CONFIG_CALC_MATH_BENCH, server
+// console trả lời "#math" bằng số chu kỳ CPU, chuẩn là double libm. Hai bên in
+// cùng một định dạng để so sánh giữa các phiên bản firmware bằng diff.
+
+#define MATH_BENCH_COLUMNS  "kernel set count per_call unit max_ulp mean_ulp max_abs worst_input"
+
+typedef struct {
+    const char* kernel;
+    const char* set;
+    int count;                  // số đầu vào thuộc miền xác định của hàm
+    double per_call;            // ns trên host, chu kỳ CPU trên thiết bị
+    double max_ulp;
+    double mean_ulp;
+    double max_abs;             // sai số tuyệt đối lớn nhất
+    double worst_input;         // đầu vào có sai số max_ulp
+} math_bench_result_t;
+
+int math_bench_count(void);  // số trường hợp
+
+int math_bench_run(int index, math_bench_result_t* result);  // đo một trường hợp, -1 nếu index ngoài phạm vi
+
+int math_bench_format(const math_bench_result_t* result, char* buf, size_t size);  // "<kernel> <set> <count> <per_call> <unit> <max_ulp> <mean_ulp> <max_abs> <worst_input>"
@@ -0,0 +1,111 @@
+#include "server-uart.h"
+#include <string.h>
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_sleep.h"
+#include "esp_pm.h"
+#include "sdkconfig.h"
+#include "calc-server.h"
+#include "console-uart.h"
+#include "async-log.h"
+
+static const char *TAG = "SERVER";
+
+#define SERVER_UART         CONFIG_ESP_CONSOLE_UART_NUM
+#define SERVER_QUEUE_LEN    4       // số dòng đang chờ giữa hai tầng liền kề
+
+typedef struct {
+    char text[SERVER_LINE_MAX];
+    int truncated;
+} server_line_t;
+
+typedef struct {
+    char text[SERVER_RESPONSE_MAX];
+    int len;
+} server_response_t;
+
+static QueueHandle_t line_queue;        // nhận -> tính
+static QueueHandle_t response_queue;    // tính -> truyền
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+static esp_pm_lock_handle_t freq_lock;  // giữ tần số tối đa trong lúc tính một yêu cầu
+#endif
+
+// Tầng nhận: gom byte thành dòng, dòng quá dài bị cắt và đánh dấu
+static void server_rx_task(void* arg) {
+    server_line_t line = {0};
+    int len = 0;
+    while (1) {
+        uint8_t c;
+        if (uart_read_bytes(SERVER_UART, &c, 1, portMAX_DELAY) != 1) continue;
+        if (c == '\n' || c == '\r') {
+            if (len == 0 && !line.truncated) continue;
+            line.text[len] = '\0';
+            xQueueSend(line_queue, &line, portMAX_DELAY);
+            len = 0;
+            line.truncated = 0;
+        } else if (len < SERVER_LINE_MAX - 1) {
+            line.text[len++] = c;
+        } else {
+            line.truncated = 1;
+        }
+    }
+}
+
+// Tầng tính: không đụng tới LCD, chỉ chạy bộ đánh giá
+static void server_eval_task(void* arg) {
+    server_line_t line;
+    server_response_t response;
+    while (1) {
+        xQueueReceive(line_queue, &line, portMAX_DELAY);
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+        esp_pm_lock_acquire(freq_lock);
+#endif
+        response.len = server_handle_line(line.text, line.truncated, response.text, sizeof(response.text));
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+        esp_pm_lock_release(freq_lock);
+#endif
+        if (response.len > 0) {
+            xQueueSend(response_queue, &response, portMAX_DELAY);
+        }
+    }
+}
+
+// Tầng truyền: gửi trả lời trong khi dòng tiếp theo đang được tính. Mỗi trả lời
+// là một lần ghi qua console-uart nên không xen vào giữa log hay bảng CSV
+static void server_tx_task(void* arg) {
+    server_response_t response;
+    while (1) {
+        xQueueReceive(response_queue, &response, portMAX_DELAY);
+        console_write(response.text, response.len);
+    }
+}
+
+void server_uart_start(void) {
+    if (console_init() != 0) {
+        ALOGE(TAG, "Cannot install UART driver");
+        return;
+    }
+#ifdef CONFIG_CALC_PM_DYNAMIC_FREQ
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "calc_server", &freq_lock) != ESP_OK) {
+        ALOGE(TAG, "Failed to create PM lock");
+        return;
+    }
+#endif
+
+#ifdef CONFIG_CALC_LIGHT_SLEEP
+    // Dữ liệu đến đánh thức chip khỏi light sleep; vài ký tự đầu bị mất
+    uart_set_wakeup_threshold(SERVER_UART, 3);
+    esp_sleep_enable_uart_wakeup(SERVER_UART);
+#endif
+
+    line_queue = xQueueCreate(SERVER_QUEUE_LEN, sizeof(server_line_t));
+    response_queue = xQueueCreate(SERVER_QUEUE_LEN, sizeof(server_response_t));
+
+    xTaskCreate(server_rx_task, "server_rx", 2048, NULL, 5, NULL);
+    // Tầng tính chạy dưới mức của giao diện (app_main, mức 1): một yêu cầu dài
+    // từ console không được làm chậm phím bấm hay LCD
+    xTaskCreate(server_eval_task, "server_eval", 8192, NULL, tskIDLE_PRIORITY, NULL);
+    xTaskCreate(server_tx_task, "server_tx", 2048, NULL, 5, NULL);
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void server_uart_start(void);  // khởi động máy chủ tính toán theo dòng trên UART console
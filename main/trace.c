@@ -0,0 +1,87 @@
+#include "trace.h"
+
+#ifdef CONFIG_CALC_TRACE
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint16_t buckets[TRACE_BUCKETS];  // saturating counts
+} trace_hist_t;
+
+static const char *const stage_names[TRACE_STAGE_COUNT] = {
+    "key_scan", "handle_key", "evaluate", "integral", "render", "lcd_frame",
+    "sin_deg", "sin_rad", "log", "pow"
+};
+
+static trace_hist_t hists[TRACE_STAGE_COUNT];
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Bucket of a cycle count: the power of two, then the next TRACE_SUB_BITS
+// bits below the leading one, so each bucket spans at most 1/4 of its value
+static int bucket_of(uint32_t cycles) {
+    if (cycles < (1u << TRACE_SUB_BITS)) return cycles;
+    int msb = 31 - __builtin_clz(cycles);
+    uint32_t sub = (cycles >> (msb - TRACE_SUB_BITS)) & ((1u << TRACE_SUB_BITS) - 1);
+    return ((msb - TRACE_SUB_BITS + 1) << TRACE_SUB_BITS) + sub;
+}
+
+// Largest cycle count that falls into bucket b
+static uint32_t bucket_top(int b) {
+    if (b < (1 << TRACE_SUB_BITS)) return b;
+    int msb = (b >> TRACE_SUB_BITS) + TRACE_SUB_BITS - 1;
+    uint32_t sub = b & ((1u << TRACE_SUB_BITS) - 1);
+    uint64_t low = ((uint64_t)((1u << TRACE_SUB_BITS) | sub)) << (msb - TRACE_SUB_BITS);
+    return (uint32_t)(low + (1ull << (msb - TRACE_SUB_BITS)) - 1);
+}
+
+void trace_record(trace_stage_t stage, uint32_t cycles) {
+    trace_hist_t *h = &hists[stage];
+    int b = bucket_of(cycles);
+    portENTER_CRITICAL_SAFE(&trace_lock);
+    if (h->count == 0 || cycles < h->min) h->min = cycles;
+    if (cycles > h->max) h->max = cycles;
+    h->count++;
+    h->sum += cycles;
+    if (h->buckets[b] != UINT16_MAX) h->buckets[b]++;
+    portEXIT_CRITICAL_SAFE(&trace_lock);
+}
+
+int trace_format(int stage, char *buf, size_t size) {
+    if (stage < 0 || stage >= TRACE_STAGE_COUNT) return -1;
+    trace_hist_t h;
+    portENTER_CRITICAL(&trace_lock);
+    h = hists[stage];
+    portEXIT_CRITICAL(&trace_lock);
+
+    // p99: top of the bucket holding the sample at rank ceil(0.99 * n),
+    // capped by the exact maximum. Saturated buckets make it an estimate.
+    uint32_t p99 = 0;
+    uint32_t total = 0;
+    for (int b = 0; b < TRACE_BUCKETS; b++) total += h.buckets[b];
+    uint32_t rank = total - total / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < TRACE_BUCKETS && total > 0; b++) {
+        seen += h.buckets[b];
+        if (seen >= rank) {
+            p99 = bucket_top(b);
+            break;
+        }
+    }
+    if (p99 > h.max) p99 = h.max;
+
+    return snprintf(buf, size, "%s %u %u %u %u %u", stage_names[stage], (unsigned)h.count,
+                    (unsigned)h.min, h.count ? (unsigned)(h.sum / h.count) : 0u,
+                    (unsigned)p99, (unsigned)h.max);
+}
+
+void trace_reset(void) {
+    portENTER_CRITICAL(&trace_lock);
+    memset(hists, 0, sizeof(hists));
+    portEXIT_CRITICAL(&trace_lock);
+}
+#endif // CONFIG_CALC_TRACE
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+// Cycle-counter trace points. Each stage keeps count, min, max, sum and a
+// log-scale histogram in static memory, so recording never allocates or
+// waits for the console. "#trace" on the console server dumps the table.
+// With CONFIG_CALC_TRACE unset the macros expand to nothing and trace.c is
+// empty, so a release build carries no trace code or data.
+//
+// CCOUNT is per core and counts CPU cycles, so a sample is only meaningful
+// when it begins and ends on the same core at one clock: stages are short,
+// and the evaluation and frame stages run under the CPU_FREQ_MAX lock.
+
+typedef enum {
+    TRACE_KEY_SCAN,         // one keypad matrix scan with debounce (timer callback)
+    TRACE_HANDLE_KEY,       // handle_key
+    TRACE_EVALUATE,         // evaluate_expression_to, all ':' parts
+    TRACE_INTEGRAL,         // one integral_step batch of trapezoid points
+    TRACE_RENDER,           // render_display composing the screen
+    TRACE_LCD_FRAME,        // plot_render + fb_flush on the display task
+    TRACE_SIN_DEG,          // my_sin_deg
+    TRACE_SIN_RAD,          // my_sin_rad
+    TRACE_LOG,              // my_log
+    TRACE_POW,              // my_pow
+    TRACE_STAGE_COUNT
+} trace_stage_t;
+
+#define TRACE_SUB_BITS  2                                   // histogram buckets per power of two = 1 << TRACE_SUB_BITS
+#define TRACE_BUCKETS   (32 << TRACE_SUB_BITS)              // covers the whole 32-bit cycle range
+
+#ifdef CONFIG_CALC_TRACE
+#include "esp_cpu.h"
+
+#define TRACE_BEGIN(name)       uint32_t name = esp_cpu_get_cycle_count()
+#define TRACE_END(stage, name)  trace_record((stage), esp_cpu_get_cycle_count() - (name))
+
+void trace_record(trace_stage_t stage, uint32_t cycles);  // add one sample, safe from any task or core
+
+int trace_format(int stage, char *buf, size_t size);  // "<name> <count> <min> <avg> <p99> <max>" in cycles, -1 if stage is out of range
+
+void trace_reset(void);  // clear every stage
+#else
+#define TRACE_BEGIN(name)       do { } while (0)
+#define TRACE_END(stage, name)  do { } while (0)
+#endif
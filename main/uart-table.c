@@ -0,0 +1,151 @@
+#include "uart-table.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "sdkconfig.h"
+#include "calc-eval.h"
+#include "console-uart.h"
+#include "async-log.h"
+
+static const char *TAG = "TABLE";
+
+// Bộ đệm kép: một nửa đang được định dạng trong khi nửa kia đang truyền
+typedef struct {
+    char data[TABLE_BUF_SIZE];
+    int len;
+} table_buffer_t;
+
+static table_buffer_t buffers[2];
+static QueueHandle_t free_queue = NULL;     // các bộ đệm rảnh để định dạng
+static QueueHandle_t full_queue = NULL;     // các bộ đệm chờ truyền
+
+// Tác vụ truyền: driver không có ring buffer TX nên gửi thẳng từ bộ đệm của ta,
+// sau đó trả bộ đệm về cho bên tính toán. Bảng giữ console suốt lúc xuất
+// (console_claim) nên log và trả lời của server không chen vào giữa các dòng.
+static void table_writer_task(void* arg) {
+    table_buffer_t* buf;
+    while (1) {
+        xQueueReceive(full_queue, &buf, portMAX_DELAY);
+        console_stream(buf->data, buf->len);
+        xQueueSend(free_queue, &buf, portMAX_DELAY);
+    }
+}
+
+int table_count(double start, double end, double step) {
+    if (!isfinite(start) || !isfinite(end) || !isfinite(step) || step == 0) return -1;
+    double span = (end - start) / step + 1e-9; // có thể là vô cực: giới hạn trong double rồi mới ép kiểu
+    if (!(span >= 0)) return -1;
+    return (int)(span < TABLE_MAX_ROWS - 1 ? span : TABLE_MAX_ROWS - 1) + 1;
+}
+
+static int table_init(void) {
+    if (free_queue != NULL) return 0;
+
+    if (console_init() != 0) {
+        ALOGE(TAG, "Cannot install UART driver");
+        return -1;
+    }
+
+    QueueHandle_t free_q = xQueueCreate(2, sizeof(table_buffer_t*));
+    full_queue = xQueueCreate(2, sizeof(table_buffer_t*));
+    if (free_q == NULL || full_queue == NULL ||
+        xTaskCreate(table_writer_task, "table_tx", 2048, NULL, 5, NULL) != pdPASS) {
+        ALOGE(TAG, "Cannot create table writer");
+        if (free_q) vQueueDelete(free_q);
+        if (full_queue) vQueueDelete(full_queue);
+        full_queue = NULL;
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        table_buffer_t* buf = &buffers[i];
+        xQueueSend(free_q, &buf, 0);
+    }
+    free_queue = free_q; // chỉ đánh dấu đã khởi tạo khi mọi thứ sẵn sàng
+    return 0;
+}
+
+static void flush_buffer(table_buffer_t** buf) {
+    if ((*buf)->len > 0) {
+        xQueueSend(full_queue, buf, portMAX_DELAY);
+        xQueueReceive(free_queue, buf, portMAX_DELAY);
+    }
+    (*buf)->len = 0;
+}
+
+const char* table_begin(table_job_t* job, const char* expr) {
+    double end;
+    char f_expr[60];
+    job->buf = NULL;
+    job->rows = job->count = 0;
+
+    const char* parse_error = parse_integral_spec(expr, &job->start, &end, &job->step, f_expr, sizeof(f_expr));
+    if (parse_error) return parse_error;
+    if (job->step == 0 || (end - job->start) / job->step < 0) return "Invalid step";
+
+    bc_status_t status = bc_compile(f_expr, &job->prog);
+    if (status != BC_OK) return bc_status_str(status);
+
+    // Số mẫu tính từ chỉ số để không cộng dồn sai số của step
+    job->count = table_count(job->start, end, job->step);
+    if (job->count < 0) return bc_status_str(BC_ERR_RANGE);
+    if (table_init() != 0) return bc_status_str(BC_ERR_OUTPUT);
+
+    console_claim();
+    table_buffer_t* buf;
+    xQueueReceive(free_queue, &buf, portMAX_DELAY);
+    buf->len = snprintf(buf->data, TABLE_BUF_SIZE, "x,f(x)\n");
+    job->buf = buf;
+    return NULL;
+}
+
+int table_step(table_job_t* job) {
+    table_buffer_t* buf = job->buf;
+    double xs[TABLE_BLOCK_ROWS], ys[TABLE_BLOCK_ROWS];
+    bc_status_t st[TABLE_BLOCK_ROWS];
+
+    int n = job->count - job->rows;
+    if (n <= 0) return 1;
+    if (n > TABLE_BLOCK_ROWS) n = TABLE_BLOCK_ROWS;
+
+    for (int i = 0; i < n; i++) {
+        xs[i] = job->start + (job->rows + i) * job->step;
+    }
+    bc_run_batch(&job->prog, xs, ys, st, n);
+
+    for (int i = 0; i < n; i++) {
+        char line[48];
+        int len;
+        if (st[i] == BC_OK) {
+            len = snprintf(line, sizeof(line), "%.7g,%.7g\n", xs[i], ys[i]);
+        } else {
+            len = snprintf(line, sizeof(line), "%.7g,%s\n", xs[i], bc_status_str(st[i]));
+        }
+        if (buf->len + len > TABLE_BUF_SIZE) flush_buffer(&buf);
+        memcpy(buf->data + buf->len, line, len);
+        buf->len += len;
+    }
+    job->buf = buf;
+    job->rows += n;
+    return job->rows >= job->count;
+}
+
+int table_percent(const table_job_t* job) {
+    return job->count > 0 ? (int)((int64_t)job->rows * 100 / job->count) : 100;
+}
+
+void table_finish(table_job_t* job) {
+    table_buffer_t* buf = job->buf;
+    if (buf == NULL) return;
+    flush_buffer(&buf);
+
+    // Chờ nửa còn lại truyền xong trước khi trả quyền dùng console
+    table_buffer_t* other;
+    xQueueReceive(free_queue, &other, portMAX_DELAY);
+    xQueueSend(free_queue, &other, 0);
+    xQueueSend(free_queue, &buf, 0);
+    console_release();
+    job->buf = NULL;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "calc-bytecode.h"
+
+#define TABLE_BLOCK_ROWS    32      // số mẫu tính theo lô trước khi định dạng
+#define TABLE_BUF_SIZE      1024    // kích thước mỗi nửa của bộ đệm kép
+#define TABLE_MAX_ROWS      100000  // giới hạn số dòng một lần xuất
+
+// Bảng f(x) trên lưới start, start+step, ... <= end, xuất CSV ra UART console.
+// table_step chỉ tính một lô để task tính toán nền chia việc theo thời gian.
+typedef struct {
+    bc_program_t prog;
+    double start, step;
+    int count;                  // số dòng của lưới
+    int rows;                   // số dòng đã tính
+    void* buf;                  // nửa bộ đệm kép đang định dạng
+} table_job_t;
+
+int table_count(double start, double end, double step);  // số dòng của lưới (tối đa TABLE_MAX_ROWS), -1 nếu khoảng hoặc bước không hợp lệ
+
+const char* table_begin(table_job_t* job, const char* expr);  // tách "[start,end,step](f)", biên dịch f và mở UART; trả về lỗi hoặc NULL
+
+int table_step(table_job_t* job);  // tính và định dạng một lô TABLE_BLOCK_ROWS dòng, trả về 1 khi xong
+
+int table_percent(const table_job_t* job);  // tiến độ 0-100
+
+void table_finish(table_job_t* job);  // gửi phần còn lại và chờ UART truyền xong, kể cả khi bị hủy giữa chừng
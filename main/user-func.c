@@ -0,0 +1,175 @@
+#include "user-func.h"
+#include <stdio.h>
+#include <string.h>
+#include "nvs.h"
+#include "async-log.h"
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#endif
+
+static const char *TAG = "UFUNC";
+
+#define USER_FUNC_COUNT (sizeof(BC_USER_FUNC_NAMES) - 1)
+
+// Bản sao trong RAM của các chương trình đã biên dịch. Giao diện, task nền,
+// task hiển thị (đồ thị) và server cùng đọc, còn giao diện và server có thể
+// định nghĩa lại. Mỗi hàm có hai chỗ chứa: bản mới được chép vào chỗ không
+// dùng rồi mới công bố bằng một lần ghi con trỏ, nên người đọc không bao giờ
+// chạy chương trình chép dở. Người ghi giữ user_func_lock; giữa hai lần định
+// nghĩa còn một lần ghi NVS, lâu hơn nhiều so với một lần chạy chương trình.
+static bc_program_t slots[USER_FUNC_COUNT][2];
+static const bc_program_t* current[USER_FUNC_COUNT];   // NULL nếu chưa định nghĩa
+
+static void (*define_hook)(void) = NULL;
+
+#ifdef ESP_PLATFORM
+static SemaphoreHandle_t define_lock;
+
+// Trước user_func_init chỉ có một task nên chưa cần khóa
+void user_func_lock(void) {
+    if (define_lock) xSemaphoreTakeRecursive(define_lock, portMAX_DELAY);
+}
+
+void user_func_unlock(void) {
+    if (define_lock) xSemaphoreGiveRecursive(define_lock);
+}
+#else
+// Bản host chạy một luồng
+void user_func_lock(void) {
+}
+
+void user_func_unlock(void) {
+}
+#endif
+
+void user_func_on_define(void (*hook)(void)) {
+    user_func_lock();
+    define_hook = hook;
+    user_func_unlock();
+}
+
+// Công bố chương trình mới của hàm index, gọi khi đang giữ user_func_lock
+static void publish(int index, const bc_program_t* prog) {
+    bc_program_t* slot = (current[index] == &slots[index][0]) ? &slots[index][1] : &slots[index][0];
+    *slot = *prog;
+    __atomic_store_n(&current[index], slot, __ATOMIC_RELEASE);
+}
+
+static int func_index(char name) {
+    const char* pos = strchr(BC_USER_FUNC_NAMES, name);
+    if (name == '\0' || pos == NULL) return -1;
+    return pos - BC_USER_FUNC_NAMES;
+}
+
+// Khóa NVS: "f" chứa bytecode, "f_src" chứa mã nguồn để biên dịch lại
+static void make_keys(char name, char* code_key, char* src_key) {
+    code_key[0] = name;
+    code_key[1] = '\0';
+    snprintf(src_key, 8, "%c_src", name);
+}
+
+static esp_err_t store_function(nvs_handle_t handle, char name, const char* src, const bc_program_t* prog) {
+    char code_key[2], src_key[8];
+    make_keys(name, code_key, src_key);
+
+    esp_err_t err = nvs_set_str(handle, src_key, src);
+    if (err == ESP_OK) err = nvs_set_blob(handle, code_key, prog, sizeof(*prog));
+    return err;
+}
+
+void user_func_init(void) {
+    nvs_handle_t handle;
+#ifdef ESP_PLATFORM
+    if (define_lock == NULL) define_lock = xSemaphoreCreateRecursiveMutex();
+#endif
+    bc_set_resolver(user_func_get);
+
+    if (nvs_open(USER_FUNC_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ALOGE(TAG, "Cannot open NVS namespace");
+        return;
+    }
+
+    int recompiled = 0;
+    user_func_lock();
+    for (int i = 0; i < USER_FUNC_COUNT; i++) {
+        char name = BC_USER_FUNC_NAMES[i];
+        char code_key[2], src_key[8];
+        make_keys(name, code_key, src_key);
+
+        bc_program_t prog;
+        size_t len = sizeof(prog);
+        esp_err_t err = nvs_get_blob(handle, code_key, &prog, &len);
+        if (err == ESP_OK && len == sizeof(prog) && bc_validate(&prog) == BC_OK) {
+            publish(i, &prog);
+            continue;
+        }
+
+        // Bytecode cũ, hỏng hoặc không qua bc_validate: biên dịch lại từ mã nguồn đã lưu
+        char src[USER_FUNC_SRC_LEN];
+        len = sizeof(src);
+        if (nvs_get_str(handle, src_key, src, &len) != ESP_OK) continue;
+
+        if (bc_compile(src, &prog) == BC_OK &&
+            nvs_set_blob(handle, code_key, &prog, sizeof(prog)) == ESP_OK) {
+            publish(i, &prog);
+            recompiled++;
+        } else {
+            ALOGE(TAG, "Cannot recompile %c(x)=%s", name, src);
+        }
+    }
+    user_func_unlock();
+
+    if (recompiled) nvs_commit(handle);
+    nvs_close(handle);
+}
+
+int user_func_is_definition(const char* expr) {
+    return func_index(expr[0]) >= 0 &&
+           strncmp(expr + 1, "(x)", 3) == 0 &&
+           (expr[4] == ':' || expr[4] == '=');
+}
+
+bc_status_t user_func_define(const char* expr) {
+    if (!user_func_is_definition(expr)) return BC_ERR_SYNTAX;
+
+    char name = expr[0];
+    const char* src = expr + 5;
+    if (strlen(src) >= USER_FUNC_SRC_LEN) return BC_ERR_TOO_LONG;
+
+    bc_program_t prog;
+    bc_status_t status = bc_compile(src, &prog);
+    if (status != BC_OK) return status;
+
+    // Giữ khóa cả khi ghi NVS để hai định nghĩa cùng lúc lưu đúng thứ tự công bố.
+    // Hook (lịch sử bỏ kết quả nhớ của f/g/h) chạy trong cùng khóa, với mọi
+    // đường định nghĩa: bàn phím hay console.
+    user_func_lock();
+    publish(func_index(name), &prog);
+    if (define_hook) define_hook();
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(USER_FUNC_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = store_function(handle, name, src, &prog);
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    user_func_unlock();
+    if (err != ESP_OK) ALOGE(TAG, "Error saving %c(x)", name);
+
+    return BC_OK;
+}
+
+const bc_program_t* user_func_get(char name) {
+    int index = func_index(name);
+    if (index < 0) return NULL;
+    return __atomic_load_n(&current[index], __ATOMIC_ACQUIRE);
+}
+
+bc_status_t user_func_call(char name, double x, double* out) {
+    const bc_program_t* prog = user_func_get(name);
+    if (prog == NULL) return BC_ERR_NO_FUNC;
+    return bc_run(prog, x, out);
+}
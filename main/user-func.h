@@ -0,0 +1,22 @@
+#pragma once
+
+#include "calc-bytecode.h"
+
+#define USER_FUNC_NAMESPACE "ufunc"     // namespace NVS riêng cho hàm người dùng
+#define USER_FUNC_SRC_LEN   64          // độ dài tối đa của thân hàm
+
+void user_func_init(void);  // nạp các hàm đã lưu trong NVS, biên dịch lại nếu khác phiên bản
+
+int user_func_is_definition(const char* expr);  // 1 nếu expr có dạng "f(x):thân" hoặc "f(x)=thân"
+
+bc_status_t user_func_define(const char* expr);  // biên dịch định nghĩa và lưu vào NVS
+
+const bc_program_t* user_func_get(char name);  // chương trình đã biên dịch, NULL nếu chưa định nghĩa
+
+bc_status_t user_func_call(char name, double x, double* out);  // gọi hàm người dùng với đối số x
+
+void user_func_lock(void);  // khóa chung (đệ quy) của các định nghĩa và kết quả nhớ phụ thuộc vào chúng
+
+void user_func_unlock(void);  // nhả khóa của user_func_lock
+
+void user_func_on_define(void (*hook)(void));  // hook chạy trong khóa sau mỗi định nghĩa mới, từ bất kỳ task nào
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Before/after report for CONFIG_CALC_HOT_IRAM (main/calc-hot.lf).
+#
+# Builds the firmware twice, with the option off and on, and prints the IRAM
+# and DRAM use from "idf.py size". When a serial port is given, it also flashes
+# each build and times a few integrals on the console server. The server
+# answers "OK <seq> <us> <result>", where <us> is the evaluation time on the
+# device.
+#   tools/hot-iram-report.sh [PORT]
+set -e
+cd "$(dirname "$0")/.."
+PORT=$1
+
+INTEGRALS='[0,3.1416](sin(x)*x^2+root(x+1))
+[0,2](x^2)
+[1,3](ln(x)*x)
+[0,1](2^x)'
+
+for hot in n y; do
+    dir=build-hot-$hot
+    mkdir -p "$dir"
+    rm -f "$dir/sdkconfig"
+    printf 'CONFIG_CALC_HOT_IRAM=%s\n' "$hot" > "$dir/hot.defaults"
+    idf.py -B "$dir" -D SDKCONFIG="$dir/sdkconfig" \
+        -D SDKCONFIG_DEFAULTS="sdkconfig;$dir/hot.defaults" build > "$dir/build.log"
+
+    echo "== CONFIG_CALC_HOT_IRAM=$hot"
+    idf.py -B "$dir" size | grep -E 'IRAM|DRAM'
+
+    if [ -n "$PORT" ]; then
+        idf.py -B "$dir" -p "$PORT" flash > "$dir/flash.log"
+        stty -F "$PORT" 115200 raw -echo
+        exec 3<>"$PORT"
+        sleep 3 # boot, LCD and splash
+        echo "$INTEGRALS" | while read -r expr; do
+            printf '%s\n' "$expr" >&3
+            reply=$(timeout 30 grep -a -m1 -E '^(OK|ERR) ' <&3 || echo timeout)
+            case "$reply" in
+                OK*) printf '  %-36s %10s us\n' "$expr" "$(echo "$reply" | cut -d' ' -f3)" ;;
+                *)   printf '  %-36s %s\n' "$expr" "$reply" ;;
+            esac
+        done
+        exec 3<&-
+    fi
+done